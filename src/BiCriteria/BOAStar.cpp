@@ -2,6 +2,7 @@
 #include <algorithm>
 
 #include "BOAStar.h"
+#include "../Utils/HugePages.h"
 
 //struct f_decider {
 //    Node::more_than_full_cost_min more_than_c_min;
@@ -17,7 +18,23 @@
 BOAStar::BOAStar(const AdjacencyMatrix &adj_matrix, Pair<double> eps, Pair<size_t> bound, const LoggerPtr logger) :
 	adj_matrix(adj_matrix), eps(eps), logger(logger), bounds(bound) {}
 
-void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider) {
+// The bound check of the expansion loop, on the values of the node's heuristic
+template <typename HeuristicType>
+inline bool out_of_bounds(const HeuristicType &, size_t, const Pair<Cost> &g, const Pair<Cost> &h,
+                          const Pair<size_t> &bound) {
+    return ((size_t)g[0]+h[0] > bound[0]) || ((size_t)g[1]+h[1] > bound[1]);
+}
+
+// Also out of bounds when the weighted sums of the criteria are
+inline bool out_of_bounds(const WeightedSumTableView &heuristic, size_t node_id, const Pair<Cost> &g,
+                          const Pair<Cost> &h, const Pair<size_t> &bound) {
+    return out_of_bounds<WeightedSumTableView>(heuristic, node_id, g, h, bound) ||
+           heuristic.exceeds_bounds(node_id, g, bound);
+}
+
+
+template <typename HeuristicType>
+void BOAStar::operator()(size_t source, size_t target, HeuristicType &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider) {
     this->start_logging(source, target);
     //Bound = this->bounds;
 
@@ -30,7 +47,7 @@ void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, Sol
     std::vector<NodePtr> closed;
 
     // Vector to hold mininum cost of 2nd criteria per node
-    std::vector<size_t> min_g2(this->adj_matrix.size()+1, MAX_COST);
+    HugePageVector<Cost> min_g2(this->adj_matrix.size()+1, MAX_COST);
 
     // Init open heap
     Node::more_than_full_cost_min more_than_c_min; //TODO change queue deciders
@@ -59,7 +76,7 @@ void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, Sol
     }
 
 
-    node = std::make_shared<Node>(source, Pair<size_t>({0,0}), heuristic(source), Bound);
+    node = std::make_shared<Node>(source, Pair<Cost>({0,0}), heuristic(source), Bound);
     open.push_back(node);
     if(decider == 0){
         std::push_heap(open.begin(), open.end(), more_than_c);
@@ -101,7 +118,7 @@ void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, Sol
         open.pop_back();
 
         // Dominance check
-        if ((((1+this->eps[1])*(node->g[1]+node->h[1])) >= min_g2[target]) ||
+        if ((((1+this->eps[1])*((size_t)node->g[1]+node->h[1])) >= min_g2[target]) ||
             (node->g[1] >= min_g2[node->id])) {
             closed.push_back(node);
             //std::cout << "f: " << node->g[1]+node->h[1] << ", min_g2_targer: " << min_g2[target] << ", g1:" << node->g[1] << ", min_g2_next: " << min_g2[node->id] << std::endl;
@@ -117,21 +134,21 @@ void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, Sol
         }
 
         // Check to which neighbors we should extend the paths
-        const std::vector<Edge> &outgoing_edges = adj_matrix[node->id];
+        const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[node->id];
         //TODO add expand
         for(auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
             size_t next_id = p_edge->target;
-            Pair<size_t> next_g = {node->g[0]+p_edge->cost[0], node->g[1]+p_edge->cost[1]};
-            Pair<size_t> next_h = heuristic(next_id);
+            Pair<Cost> next_g = {node->g[0]+p_edge->cost[0], node->g[1]+p_edge->cost[1]};
+            Pair<Cost> next_h = heuristic(next_id);
             //std::cout << "next_g: " << next_g << std::endl;
             //std::cout << "next_h: " << next_h << std::endl;
             //TODO add bound check
-            if(next_g[0]+next_h[0] > Bound[0] || next_g[1]+next_h[1] > Bound[1]){
+            if(out_of_bounds(heuristic, next_id, next_g, next_h, Bound)){
                 //std::cout << "f1: " << next_g[0]+next_h[0] << ", f2: " << next_g[1]+next_h[1] << std::endl;
                 continue;
             }
             // Dominance check
-            if ((((1+this->eps[1])*(next_g[1]+next_h[1])) >= min_g2[target]) ||
+            if ((((1+this->eps[1])*((size_t)next_g[1]+next_h[1])) >= min_g2[target]) ||
                 (next_g[1] >= min_g2[next_id])) {
                 //std::cout << "f: " << next_g[1]+next_h[1] << ", min_g2_targer: " << min_g2[target] << ", g1:" << next_g[1] << ", min_g2_next: " << min_g2[next_id] << std::endl;
                 continue;
@@ -168,6 +185,30 @@ void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, Sol
     this->end_logging(solutions, expended, generated);
 }
 
+template void BOAStar::operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider);
+template void BOAStar::operator()(size_t source, size_t target, HeuristicTableView &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider);
+template void BOAStar::operator()(size_t source, size_t target, WeightedSumTableView &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider);
+
+
+void BOAStar::set_vertex_ordering(const VertexOrdering *ordering) {
+    this->ordering = ordering;
+}
+
+
+void BOAStar::set_graph_simplification(const GraphSimplification *simplification) {
+    this->simplification = simplification;
+}
+
+
+size_t BOAStar::expanded_nodes() const {
+    return this->expanded;
+}
+
+
+size_t BOAStar::generated_nodes() const {
+    return this->generated;
+}
+
 
 void BOAStar::start_logging(size_t source, size_t target) {
     // All logging is done in JSON format
@@ -180,12 +221,19 @@ void BOAStar::start_logging(size_t source, size_t target) {
         << "}";
 
     if (this->logger != nullptr) {
+        if (this->ordering != nullptr) {
+            source = this->ordering->to_original(source);
+            target = this->ordering->to_original(target);
+        }
         LOG_START_SEARCH(*this->logger, source, target, start_info_json.str());
     }
 }
 
 
 void BOAStar::end_logging(SolutionSet &solutions, int expended, int generated) {
+    this->expanded = expended;
+    this->generated = generated;
+
     // All logging is done in JSON format
     std::stringstream finish_info_json;
     //TODO add expanded and generated nodes nodes
@@ -200,9 +248,13 @@ void BOAStar::end_logging(SolutionSet &solutions, int expended, int generated) {
         << "\n"
         <<      "\t\"solutions\": [";
 
+    SolutionSet logged_solutions = (this->simplification != nullptr) ? this->simplification->expand(solutions) : solutions;
+    if (this->ordering != nullptr) {
+        logged_solutions = this->ordering->to_original(logged_solutions);
+    }
     size_t solutions_count = 0;
-    for (auto solution = solutions.begin(); solution != solutions.end(); ++solution) {
-        if (solution != solutions.begin()) {
+    for (auto solution = logged_solutions.begin(); solution != logged_solutions.end(); ++solution) {
+        if (solution != logged_solutions.begin()) {
             finish_info_json << ",";
         }
         finish_info_json << "\n\t\t" << **solution;
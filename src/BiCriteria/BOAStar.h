@@ -4,20 +4,35 @@
 #include <vector>
 #include "../Utils/Definitions.h"
 #include "../Utils/Logger.h"
+#include "../Utils/GraphReordering.h"
+#include "../Utils/GraphSimplification.h"
 
 class BOAStar {
 private:
     const AdjacencyMatrix   &adj_matrix;
     Pair<double>            eps;
     const LoggerPtr         logger;
+    const VertexOrdering    *ordering = nullptr;
+    const GraphSimplification *simplification = nullptr;
     Pair<size_t>            bounds;
+    size_t                  expanded = 0;
+    size_t                  generated = 0;
 
     void start_logging(size_t source, size_t target);
     void end_logging(SolutionSet &solutions, int expended, int generated);
 
 public:
     BOAStar(const AdjacencyMatrix &adj_matrix, Pair<double> eps, Pair<size_t> bound, const LoggerPtr logger=nullptr);
-    void operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider=1);
+    // Compiled for Heuristic, HeuristicTableView and WeightedSumTableView
+    template <typename HeuristicType>
+    void operator()(size_t source, size_t target, HeuristicType &heuristic, SolutionSet &solutions, Pair<size_t> Bound, int decider=1);
+    // Set when searching a reordered graph, so logs report the original vertex ids
+    void set_vertex_ordering(const VertexOrdering *ordering);
+    // Set when searching a simplified graph, so logged solutions are expanded to the full vertex paths
+    void set_graph_simplification(const GraphSimplification *simplification);
+    // Nodes expanded and generated by the last search, as logged
+    size_t expanded_nodes(void) const;
+    size_t generated_nodes(void) const;
 };
 
 #endif //BI_CRITERIA_BOA_STAR_H
\ No newline at end of file
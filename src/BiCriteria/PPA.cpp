@@ -2,6 +2,7 @@
 #include <vector>
 
 #include "PPA.h"
+#include "../Utils/HugePages.h"
 
 
 PPA::PPA(const AdjacencyMatrix &adj_matrix, Pair<double> eps, const LoggerPtr logger) :
@@ -41,7 +42,8 @@ void PPA::merge_to_solutions(const PathPairPtr &pp, PPSolutionSet &solutions) {
 }
 
 
-void PPA::operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions) {
+template <typename HeuristicType>
+void PPA::operator()(size_t source, size_t target, HeuristicType &heuristic, SolutionSet &solutions) {
     this->start_logging(source, target);
 
     PPSolutionSet pp_solutions;
@@ -52,12 +54,12 @@ void PPA::operator()(size_t source, size_t target, Heuristic &heuristic, Solutio
     std::vector<PathPairPtr> closed;
 
     // Vector to hold mininum cost of 2nd criteria per node
-    std::vector<size_t> min_g2(this->adj_matrix.size()+1, MAX_COST);
+    HugePageVector<Cost> min_g2(this->adj_matrix.size()+1, MAX_COST);
 
     // Init open heap
     PPQueue open(this->adj_matrix.size()+1);
 
-    NodePtr source_node = std::make_shared<Node>(source, Pair<size_t>({0,0}), heuristic(source));
+    NodePtr source_node = std::make_shared<Node>(source, Pair<Cost>({0,0}), heuristic(source));
     pp = std::make_shared<PathPair>(source_node, source_node);
     open.insert(pp);
 
@@ -84,18 +86,18 @@ void PPA::operator()(size_t source, size_t target, Heuristic &heuristic, Solutio
         }
 
         // Check to which neighbors we should extend the paths
-        const std::vector<Edge> &outgoing_edges = adj_matrix[pp->id];
+        const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[pp->id];
         for(auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
             // Prepare extension of path pair
             size_t next_id = p_edge->target;
-            Pair<size_t> top_left_next_g = {pp->top_left->g[0]+p_edge->cost[0],
-                                            pp->top_left->g[1]+p_edge->cost[1]};
-            Pair<size_t> bottom_right_next_g = {pp->bottom_right->g[0]+p_edge->cost[0],
-                                                pp->bottom_right->g[1]+p_edge->cost[1]};
-            Pair<size_t> next_h = heuristic(next_id);
+            Pair<Cost> top_left_next_g = {pp->top_left->g[0]+p_edge->cost[0],
+                                          pp->top_left->g[1]+p_edge->cost[1]};
+            Pair<Cost> bottom_right_next_g = {pp->bottom_right->g[0]+p_edge->cost[0],
+                                              pp->bottom_right->g[1]+p_edge->cost[1]};
+            Pair<Cost> next_h = heuristic(next_id);
 
             // Dominance check
-            if ((((1+this->eps[1])*(bottom_right_next_g[1]+next_h[1])) >= min_g2[target]) ||
+            if ((((1+this->eps[1])*((size_t)bottom_right_next_g[1]+next_h[1])) >= min_g2[target]) ||
                 (bottom_right_next_g[1] >= min_g2[next_id])) {
                 continue;
             }
@@ -124,6 +126,19 @@ void PPA::operator()(size_t source, size_t target, Heuristic &heuristic, Solutio
     this->end_logging(pair_solutions);
 }
 
+template void PPA::operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions);
+template void PPA::operator()(size_t source, size_t target, HeuristicTableView &heuristic, SolutionSet &solutions);
+
+
+void PPA::set_vertex_ordering(const VertexOrdering *ordering) {
+    this->ordering = ordering;
+}
+
+
+void PPA::set_graph_simplification(const GraphSimplification *simplification) {
+    this->simplification = simplification;
+}
+
 
 void PPA::start_logging(size_t source, size_t target) {
     // All logging is done in JSON format
@@ -135,6 +150,10 @@ void PPA::start_logging(size_t source, size_t target) {
         << "}";
 
     if (this->logger != nullptr) {
+        if (this->ordering != nullptr) {
+            source = this->ordering->to_original(source);
+            target = this->ordering->to_original(target);
+        }
         LOG_START_SEARCH(*this->logger, source, target, start_info_json.str());
     }
 }
@@ -147,9 +166,13 @@ void PPA::end_logging(SolutionSet &solutions) {
         << "{\n"
         <<      "\t\"solutions\": [";
 
+    SolutionSet logged_solutions = (this->simplification != nullptr) ? this->simplification->expand(solutions) : solutions;
+    if (this->ordering != nullptr) {
+        logged_solutions = this->ordering->to_original(logged_solutions);
+    }
     size_t solutions_count = 0;
-    for (auto solution = solutions.begin(); solution != solutions.end(); ++solution) {
-        if (solution != solutions.begin()) {
+    for (auto solution = logged_solutions.begin(); solution != logged_solutions.end(); ++solution) {
+        if (solution != logged_solutions.begin()) {
             finish_info_json << ",";
         }
         finish_info_json << "\n\t\t" << **solution;
@@ -3,6 +3,8 @@
 
 #include "../Utils/Definitions.h"
 #include "../Utils/Logger.h"
+#include "../Utils/GraphReordering.h"
+#include "../Utils/GraphSimplification.h"
 #include "../Utils/PPQueue.h"
 
 
@@ -11,6 +13,8 @@ private:
     const AdjacencyMatrix   &adj_matrix;
     Pair<double>            eps;
     const LoggerPtr         logger;
+    const VertexOrdering    *ordering = nullptr;
+    const GraphSimplification *simplification = nullptr;
 
     void start_logging(size_t source, size_t target);
     void end_logging(SolutionSet &solutions);
@@ -20,7 +24,13 @@ private:
 
 public:
     PPA(const AdjacencyMatrix &adj_matrix, Pair<double> eps, const LoggerPtr logger=nullptr);
-    void operator()(size_t source, size_t target, Heuristic &heuristic, SolutionSet &solutions);
+    // Compiled for Heuristic and HeuristicTableView
+    template <typename HeuristicType>
+    void operator()(size_t source, size_t target, HeuristicType &heuristic, SolutionSet &solutions);
+    // Set when searching a reordered graph, so logs report the original vertex ids
+    void set_vertex_ordering(const VertexOrdering *ordering);
+    // Set when searching a simplified graph, so logged solutions are expanded to the full vertex paths
+    void set_graph_simplification(const GraphSimplification *simplification);
 };
 
 #endif //BI_CRITERIA_PPA_H
\ No newline at end of file
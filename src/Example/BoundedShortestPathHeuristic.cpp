@@ -0,0 +1,69 @@
+#include <algorithm>
+
+#include "BoundedShortestPathHeuristic.h"
+
+
+BoundedShortestPathHeuristic::BoundedShortestPathHeuristic(size_t source, const AdjacencyMatrix &adj_matrix,
+                                                           Pair<size_t> bound)
+    : tables(std::make_shared<Tables>()) {
+    this->tables->h.assign(adj_matrix.size()+1, Pair<Cost>({MAX_COST, MAX_COST}));
+    this->tables->searches.reserve(2);
+    for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+        this->tables->searches.emplace_back(adj_matrix.size()+1);
+        this->tables->h[source][cost_idx] = 0;
+        this->tables->searches[cost_idx].open.push_or_decrease(source, 0);
+    }
+    this->extend(adj_matrix, bound);
+}
+
+
+void BoundedShortestPathHeuristic::extend(const AdjacencyMatrix &adj_matrix, Pair<size_t> bound) {
+    settle(0, adj_matrix, bound[0]);
+    settle(1, adj_matrix, bound[1]);
+}
+
+
+// Dijkstra on cost_idx as in ShortestPathHeuristic::compute(), paused before the first vertex whose value
+// is over the bound. Vertices settle by increasing cost, so the values of all the others are over it too.
+void BoundedShortestPathHeuristic::settle(size_t cost_idx, const AdjacencyMatrix &adj_matrix, size_t bound) {
+    HugePageVector<Pair<Cost>> &h = this->tables->h;
+    Search &search = this->tables->searches[cost_idx];
+
+    while (search.open.empty() == false) {
+        search.frontier = search.open.top_key();
+        if (heuristic_value(search.frontier) > bound) {
+            return;
+        }
+
+        size_t vertex = search.open.pop();
+        Cost vertex_h = h[vertex][cost_idx];
+        search.settled++;
+
+        const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[vertex];
+        for(auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
+            Cost next_h = vertex_h + p_edge->cost[cost_idx];
+            if (h[p_edge->target][cost_idx] <= next_h) {
+                continue;
+            }
+
+            h[p_edge->target][cost_idx] = next_h;
+            search.open.push_or_decrease(p_edge->target, next_h);
+        }
+    }
+    search.frontier = MAX_COST;
+}
+
+
+// Settled values are at most the frontier and the others at least the frontier. Scaled per lookup, the table of a
+// paused search still changes, settled vertices get the values of ShortestPathHeuristic.
+Pair<Cost> BoundedShortestPathHeuristic::operator()(size_t node_id) {
+    const Pair<Cost> &h = this->tables->h[node_id];
+    Cost h1 = heuristic_value(std::min(h[0], this->tables->searches[0].frontier));
+    Cost h2 = heuristic_value(std::min(h[1], this->tables->searches[1].frontier));
+    return Pair<Cost>{h1, h2};
+}
+
+
+Pair<size_t> BoundedShortestPathHeuristic::settled_vertices() const {
+    return {{this->tables->searches[0].settled, this->tables->searches[1].settled}};
+}
@@ -0,0 +1,49 @@
+#ifndef EXAMPLE_BOUNDED_SHORTEST_PATH_HEURISTIC_H
+#define EXAMPLE_BOUNDED_SHORTEST_PATH_HEURISTIC_H
+
+#include <memory>
+#include <vector>
+#include "../Utils/Definitions.h"
+#include "../Utils/HugePages.h"
+#include "../Utils/IndexedHeap.h"
+
+
+// Shortest path heuristic for bounded searches, which discard every node with g+h over the bound of
+// either criterion. The reverse Dijkstra of each criterion stops once the value of its next vertex would
+// exceed the bound: nodes of the vertices left unsettled are discarded whatever their exact value, so they
+// get the frontier's value instead (a lower bound of it, and over the bound as well). Settled vertices get
+// the values of ShortestPathHeuristic, a bounded search expands the same nodes with either of them.
+// A larger bound later resumes the searches where they stopped.
+class BoundedShortestPathHeuristic {
+private:
+    // Stopped Dijkstra of one criterion, it settles vertices by increasing cost
+    struct Search {
+        IndexedHeap open;
+        Cost        frontier = 0;   // Cost of the next vertex to settle, MAX_COST once all reachable ones are
+        size_t      settled = 0;
+
+        Search(size_t vertices) : open(vertices) {}
+    };
+
+    // Shared by copies of the heuristic (it is copied into std::bind)
+    struct Tables {
+        HugePageVector<Pair<Cost>>  h;          // Costs of the settled vertices, tentative ones past the frontier
+        std::vector<Search>         searches;   // Per criterion
+    };
+
+    std::shared_ptr<Tables> tables;
+
+    void settle(size_t cost_idx, const AdjacencyMatrix &adj_matrix, size_t bound);
+public:
+    // Searches adj_matrix from `source` as far as the search bounds reach
+    BoundedShortestPathHeuristic(size_t source, const AdjacencyMatrix &adj_matrix, Pair<size_t> bound);
+    // Resumes the searches up to a larger bound, adj_matrix must be the graph they started on.
+    // Searches using the heuristic must not run meanwhile.
+    void extend(const AdjacencyMatrix &adj_matrix, Pair<size_t> bound);
+    Pair<Cost> operator()(size_t node_id);
+
+    // Vertices settled so far per criterion
+    Pair<size_t> settled_vertices(void) const;
+};
+
+#endif //EXAMPLE_BOUNDED_SHORTEST_PATH_HEURISTIC_H
@@ -0,0 +1,84 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+#include "GeometricHeuristic.h"
+
+// Floating point errors of the scaled distances must never make a bound exceed the true cost
+const double SCALE_SAFETY_FACTOR = 1 - 1e-9;
+const double EARTH_RADIUS = 6371000;
+const double MICRO_DEGREES_TO_RADIANS = M_PI / 180 / 1e6;
+
+
+GeometricEmbedding::GeometricEmbedding(const AdjacencyMatrix &graph, const std::vector<Pair<double>> &coordinates,
+                                       Metric metric)
+    : points(graph.size()+1), cost_scales({{std::numeric_limits<double>::infinity(),
+                                            std::numeric_limits<double>::infinity()}}) {
+    if (coordinates.size() < graph.size()+1) {
+        throw std::invalid_argument("Missing coordinates for some of the graph vertices");
+    }
+
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        if (metric == Metric::EUCLIDEAN) {
+            this->points[vertex] = {{coordinates[vertex][0], coordinates[vertex][1], 0}};
+        } else {
+            double longitude = coordinates[vertex][0] * MICRO_DEGREES_TO_RADIANS;
+            double latitude = coordinates[vertex][1] * MICRO_DEGREES_TO_RADIANS;
+            this->points[vertex] = {{EARTH_RADIUS * std::cos(latitude) * std::cos(longitude),
+                                     EARTH_RADIUS * std::cos(latitude) * std::sin(longitude),
+                                     EARTH_RADIUS * std::sin(latitude)}};
+        }
+    }
+
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        const AdjacencyMatrix::Neighbors outgoing_edges = graph[vertex];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+            double arc_distance = this->distance(vertex, p_edge->target);
+            if (arc_distance == 0) {
+                continue; // Any cost is at least 0 times the distance
+            }
+            for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+                this->cost_scales[cost_idx] = std::min(this->cost_scales[cost_idx],
+                                                       p_edge->cost[cost_idx] / arc_distance);
+            }
+        }
+    }
+
+    for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+        if (std::isinf(this->cost_scales[cost_idx])) {
+            this->cost_scales[cost_idx] = 0; // No arc with a length, nothing to bound with
+        }
+        this->cost_scales[cost_idx] *= SCALE_SAFETY_FACTOR;
+    }
+}
+
+
+double GeometricEmbedding::distance(size_t vertex1, size_t vertex2) const {
+    const std::array<double, 3> &point1 = this->points[vertex1];
+    const std::array<double, 3> &point2 = this->points[vertex2];
+    double dx = point1[0] - point2[0];
+    double dy = point1[1] - point2[1];
+    double dz = point1[2] - point2[2];
+    return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+
+Pair<double> GeometricEmbedding::cost_scale() const {return this->cost_scales;}
+
+
+GeometricHeuristic::GeometricHeuristic(size_t target, const GeometricEmbedding &embedding)
+    : target(target), embedding(embedding) {}
+
+
+Pair<Cost> GeometricHeuristic::operator()(size_t node_id) {
+    double distance = this->embedding.distance(node_id, this->target);
+    Pair<double> cost_scale = this->embedding.cost_scale();
+    Pair<Cost> bound;
+    for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+        // Only vertices that can not reach the target at all may exceed the cost range
+        double scaled = cost_scale[cost_idx] * distance;
+        bound[cost_idx] = (scaled >= (double)MAX_COST) ? MAX_COST : (Cost)scaled;
+    }
+    return bound;
+}
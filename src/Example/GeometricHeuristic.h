@@ -0,0 +1,46 @@
+#ifndef EXAMPLE_GEOMETRIC_HEURISTIC_H
+#define EXAMPLE_GEOMETRIC_HEURISTIC_H
+
+#include <array>
+#include <vector>
+#include "../Utils/Definitions.h"
+#include "../Utils/HugePages.h"
+
+
+// Vertex positions of a graph (see load_co_file) together with the smallest cost per unit of
+// distance over all of its arcs, per cost. For travel times that is the inverse of the highest
+// speed on the map. Distances obey the triangle inequality, so every path from u to v costs at
+// least cost_scale * distance(u, v). Computed once per graph and shared by all queries.
+class GeometricEmbedding {
+public:
+    // EUCLIDEAN treats the coordinates as planar, GREAT_CIRCLE as longitude and latitude in
+    // millionths of a degree (DIMACS road maps). Great circle distances are measured along the
+    // chord through the sphere, which is monotone in the arc length and cheaper to evaluate.
+    enum class Metric {EUCLIDEAN, GREAT_CIRCLE};
+
+private:
+    HugePageVector<std::array<double, 3>>   points;
+    Pair<double>                            cost_scales;
+
+public:
+    GeometricEmbedding(const AdjacencyMatrix &graph, const std::vector<Pair<double>> &coordinates,
+                       Metric metric=Metric::GREAT_CIRCLE);
+
+    double distance(size_t vertex1, size_t vertex2) const;
+    Pair<double> cost_scale(void) const;
+};
+
+
+// Admissible heuristic that needs no preprocessing per target: on call to operator() returns
+// the scaled distance from the vertex to the target in O(1)
+class GeometricHeuristic {
+private:
+    size_t                      target;
+    const GeometricEmbedding    &embedding;
+
+public:
+    GeometricHeuristic(size_t target, const GeometricEmbedding &embedding);
+    Pair<Cost> operator()(size_t node_id);
+};
+
+#endif // EXAMPLE_GEOMETRIC_HEURISTIC_H
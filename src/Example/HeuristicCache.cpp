@@ -0,0 +1,102 @@
+#include "HeuristicCache.h"
+
+
+HeuristicCache::HeuristicCache(size_t memory_budget) : memory_budget(memory_budget) {}
+
+
+ShortestPathHeuristic HeuristicCache::get(const std::string &graph_name, size_t target,
+                                          const AdjacencyMatrix &inv_graph, size_t threads) {
+    return this->get(Key(graph_name, target), [&]() {
+        return std::make_shared<ShortestPathHeuristic>(target, inv_graph.size(), inv_graph, threads);
+    });
+}
+
+
+ShortestPathHeuristic HeuristicCache::get(const std::string &graph_name, size_t target,
+                                          Pair<const ContractionHierarchy *> hierarchies) {
+    return this->get(Key(graph_name, target), [&]() {
+        return std::make_shared<ShortestPathHeuristic>(target, hierarchies);
+    });
+}
+
+
+ShortestPathHeuristic HeuristicCache::get(const Key &key, const std::function<HeuristicPtr(void)> &compute) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    auto entry = this->entries.find(key);
+    if (entry != this->entries.end()) {
+        this->counters.hits++;
+        this->lru.splice(this->lru.begin(), this->lru, entry->second.lru_position);
+        std::shared_future<HeuristicPtr> heuristic = entry->second.heuristic;
+        lock.unlock();
+        return *heuristic.get(); // Waits if another thread is still computing it
+    }
+
+    // Register the pending computation, so other requests for the target wait for it instead of computing again
+    this->counters.misses++;
+    std::promise<HeuristicPtr> computed;
+    this->lru.push_front(key);
+    this->entries[key] = {computed.get_future().share(), 0, this->lru.begin()};
+    lock.unlock();
+
+    HeuristicPtr heuristic;
+    try {
+        heuristic = compute();
+    } catch (...) {
+        // Failed computations are not cached, the waiting requests get the exception
+        computed.set_exception(std::current_exception());
+        lock.lock();
+        entry = this->entries.find(key);
+        this->lru.erase(entry->second.lru_position);
+        this->entries.erase(entry);
+        throw;
+    }
+    computed.set_value(heuristic);
+
+    lock.lock();
+    entry = this->entries.find(key);
+    entry->second.memory = heuristic->memory_usage();
+    this->resident_memory += entry->second.memory;
+    this->evict_over_budget();
+    return *heuristic;
+}
+
+
+void HeuristicCache::evict_over_budget() {
+    // The most recently used heuristic is kept even if it exceeds the budget on its own.
+    // Heuristics still being computed have no memory accounted yet and are skipped.
+    auto candidate = this->lru.end();
+    while ((this->resident_memory > this->memory_budget) && (candidate != this->lru.begin())) {
+        --candidate;
+        if (candidate == this->lru.begin()) {
+            break;
+        }
+
+        auto entry = this->entries.find(*candidate);
+        if (entry->second.memory == 0) {
+            continue;
+        }
+        this->resident_memory -= entry->second.memory;
+        this->counters.evictions++;
+        this->entries.erase(entry);
+        candidate = this->lru.erase(candidate);
+    }
+}
+
+
+void HeuristicCache::set_memory_budget(size_t memory_budget) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->memory_budget = memory_budget;
+    this->evict_over_budget();
+}
+
+
+size_t HeuristicCache::memory_usage() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->resident_memory;
+}
+
+
+HeuristicCache::Stats HeuristicCache::stats() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->counters;
+}
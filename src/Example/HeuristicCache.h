@@ -0,0 +1,67 @@
+#ifndef EXAMPLE_HEURISTIC_CACHE_H
+#define EXAMPLE_HEURISTIC_CACHE_H
+
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include "ShortestPathHeuristic.h"
+
+// Process wide cache of shortest path heuristics keyed by graph and target, so the reverse Dijkstras
+// of a target are paid once no matter how many bounds, deciders or queries search towards it.
+// The graph name is the caller's promise that the same name always comes with the same reverse graph
+// (vertex ids included, e.g. a map after the same reordering). Resident tables are kept under a memory
+// budget by evicting the least recently used ones, like GraphRegistry. Safe to use from several threads,
+// concurrent requests for a heuristic being computed wait for that single computation.
+class HeuristicCache {
+public:
+    struct Stats {
+        size_t  hits = 0;
+        size_t  misses = 0;
+        size_t  evictions = 0;
+    };
+
+private:
+    using Key = std::pair<std::string, size_t>;
+    using HeuristicPtr = std::shared_ptr<ShortestPathHeuristic>;
+
+    struct Entry {
+        std::shared_future<HeuristicPtr>    heuristic;
+        size_t                              memory;
+        std::list<Key>::iterator            lru_position;
+    };
+
+    mutable std::mutex          mutex;
+    size_t                      memory_budget;
+    size_t                      resident_memory = 0;
+    std::map<Key, Entry>        entries;
+    std::list<Key>              lru;            // Most recently used first
+    Stats                       counters;
+
+    ShortestPathHeuristic get(const Key &key, const std::function<HeuristicPtr(void)> &compute);
+    void evict_over_budget(void);
+
+public:
+    HeuristicCache(size_t memory_budget=SIZE_MAX);
+    HeuristicCache(const HeuristicCache &) = delete;
+    HeuristicCache& operator=(const HeuristicCache &) = delete;
+
+    // Returns the heuristic towards `target` computed on `inv_graph` (see ShortestPathHeuristic), computing it
+    // with `threads` threads on a miss. The returned copy shares the cached tables and outlives their eviction.
+    ShortestPathHeuristic get(const std::string &graph_name, size_t target, const AdjacencyMatrix &inv_graph,
+                              size_t threads=1);
+    // The same from contraction hierarchies of inv_graph, filled by PHAST on a miss. Heuristics cached
+    // under the same name are shared by both ways of computing them, their values are the same.
+    ShortestPathHeuristic get(const std::string &graph_name, size_t target,
+                              Pair<const ContractionHierarchy *> hierarchies);
+    // Evicts heuristics until the resident ones fit the new budget
+    void set_memory_budget(size_t memory_budget);
+    size_t memory_usage(void) const;
+    Stats stats(void) const;
+};
+
+#endif //EXAMPLE_HEURISTIC_CACHE_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "HeuristicStore.h"
+#include "LandmarkHeuristic.h"
+
+// Store layout: the header below, the targets (VertexId values, padded to a multiple of 8 bytes) and then
+// per target in the same order its table of graph_size+1 entries, the heuristic values of the costs from every
+// vertex to the target per criterion (see heuristic_value, MAX_COST is scaled too if unreachable). Like landmark files the header records the value widths,
+// byte order and the fingerprint of the graph.
+const char      STORE_MAGIC[8]      = {'P', 'P', 'G', 'H', 'E', 'U', 'R', 'S'};
+const uint32_t  STORE_VERSION       = 2;
+const uint32_t  STORE_BYTE_ORDER    = 0x01020304;
+const size_t    STORE_ALIGNMENT     = 8;
+
+struct HeuristicStoreHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order;
+    uint32_t    vertex_id_size;
+    uint32_t    cost_size;
+    uint64_t    graph_size;
+    uint64_t    count;
+    uint64_t    fingerprint;
+};
+
+
+size_t store_targets_size(size_t count) {
+    return ((count*sizeof(VertexId) + STORE_ALIGNMENT - 1) / STORE_ALIGNMENT) * STORE_ALIGNMENT;
+}
+
+
+bool HeuristicStore::open(std::string store_file, const AdjacencyMatrix &graph) {
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if ((mapping->open(store_file) == false) || (mapping->size() < sizeof(HeuristicStoreHeader))) {
+        return false;
+    }
+
+    const HeuristicStoreHeader *header = reinterpret_cast<const HeuristicStoreHeader *>(mapping->begin());
+    if ((std::equal(STORE_MAGIC, STORE_MAGIC+sizeof(STORE_MAGIC), header->magic) == false) ||
+        (header->version != STORE_VERSION) ||
+        (header->byte_order != STORE_BYTE_ORDER) ||
+        (header->vertex_id_size != sizeof(VertexId)) ||
+        (header->cost_size != sizeof(Cost)) ||
+        (header->graph_size != graph.size())) {
+        return false; // Incompatible build or another graph
+    }
+    // A count the file is too small to hold is rejected first, the size of the tables can not overflow then
+    // (graph_size was checked against the graph above)
+    if (header->count > mapping->size() / ((header->graph_size+1)*sizeof(Pair<Cost>))) {
+        return false;
+    }
+    size_t expected_size = sizeof(HeuristicStoreHeader) + store_targets_size(header->count) +
+                           header->count*(header->graph_size+1)*sizeof(Pair<Cost>);
+    if ((mapping->size() != expected_size) || (header->fingerprint != graph_fingerprint(graph))) {
+        return false; // Truncated file or stale tables
+    }
+
+    const VertexId *targets = reinterpret_cast<const VertexId *>(mapping->begin() + sizeof(HeuristicStoreHeader));
+    this->slots.clear();
+    for (size_t slot = 0; slot < header->count; ++slot) {
+        this->slots[targets[slot]] = slot;
+    }
+    this->graph_size = header->graph_size;
+    this->tables = reinterpret_cast<const Pair<Cost> *>(mapping->begin() + sizeof(HeuristicStoreHeader) +
+                                                          store_targets_size(header->count));
+    this->mapping = mapping;
+    return true;
+}
+
+
+bool HeuristicStore::contains(size_t target) const {
+    return this->slots.find(target) != this->slots.end();
+}
+
+
+size_t HeuristicStore::count() const {return this->slots.size();}
+
+
+bool save_heuristic_store(std::string store_file, const AdjacencyMatrix &graph, const std::vector<size_t> &targets,
+                          Pair<const ContractionHierarchy *> inv_hierarchies) {
+    if ((inv_hierarchies[0]->criterion() != 0) || (inv_hierarchies[1]->criterion() != 1) ||
+        (inv_hierarchies[0]->size() != graph.size()) || (inv_hierarchies[1]->size() != graph.size())) {
+        return false;
+    }
+    std::vector<size_t> unique_targets(targets);
+    std::sort(unique_targets.begin(), unique_targets.end());
+    unique_targets.erase(std::unique(unique_targets.begin(), unique_targets.end()), unique_targets.end());
+    if ((unique_targets.empty() == false) && (unique_targets.back() > graph.size())) {
+        return false;
+    }
+
+    std::ofstream file(store_file.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (file.is_open() == false) {
+        return false;
+    }
+
+    HeuristicStoreHeader header = {};
+    std::copy(STORE_MAGIC, STORE_MAGIC+sizeof(STORE_MAGIC), header.magic);
+    header.version = STORE_VERSION;
+    header.byte_order = STORE_BYTE_ORDER;
+    header.vertex_id_size = sizeof(VertexId);
+    header.cost_size = sizeof(Cost);
+    header.graph_size = graph.size();
+    header.count = unique_targets.size();
+    header.fingerprint = graph_fingerprint(graph);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<VertexId> target_ids(unique_targets.begin(), unique_targets.end());
+    const char padding[STORE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(target_ids.data()), target_ids.size()*sizeof(VertexId));
+    file.write(padding, store_targets_size(target_ids.size()) - target_ids.size()*sizeof(VertexId));
+
+    // Targets are swept a batch at a time, the interleaved tables of a batch are split per target
+    const size_t batch_size = ContractionHierarchy::BATCH_SIZE;
+    size_t vertices_count = graph.size()+1;
+    Pair<HugePageVector<Cost>> batch_tables = {{HugePageVector<Cost>(vertices_count*batch_size),
+                                                HugePageVector<Cost>(vertices_count*batch_size)}};
+    std::vector<Pair<Cost>> table(vertices_count);
+    for (size_t first = 0; first < unique_targets.size(); first += batch_size) {
+        std::vector<size_t> batch(unique_targets.begin() + first,
+                                  unique_targets.begin() + std::min(first + batch_size, unique_targets.size()));
+        inv_hierarchies[0]->many_to_all(batch, batch_tables[0].data());
+        inv_hierarchies[1]->many_to_all(batch, batch_tables[1].data());
+        for (size_t lane = 0; lane < batch.size(); ++lane) {
+            for (size_t vertex = 0; vertex < vertices_count; ++vertex) {
+                table[vertex] = {{heuristic_value(batch_tables[0][vertex*batch_size + lane]),
+                                  heuristic_value(batch_tables[1][vertex*batch_size + lane])}};
+            }
+            file.write(reinterpret_cast<const char *>(table.data()), table.size()*sizeof(Pair<Cost>));
+        }
+    }
+    return file.good();
+}
+
+
+StoredHeuristic::StoredHeuristic(size_t target, const HeuristicStore &store) : mapping(store.mapping) {
+    auto slot = store.slots.find(target);
+    if (slot == store.slots.end()) {
+        throw std::out_of_range("Target not in the heuristic store");
+    }
+    this->table = store.tables + slot->second*(store.graph_size+1);
+}
+
+
+// Stored already scaled like ShortestPathHeuristic
+Pair<Cost> StoredHeuristic::operator()(size_t node_id) {
+    return this->table[node_id];
+}
+
+
+HeuristicTableView StoredHeuristic::view() const {
+    return HeuristicTableView(this->table);
+}
@@ -0,0 +1,54 @@
+#ifndef EXAMPLE_HEURISTIC_STORE_H
+#define EXAMPLE_HEURISTIC_STORE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Utils/Definitions.h"
+#include "../Utils/MappedFile.h"
+#include "../Utils/ContractionHierarchy.h"
+
+
+// Shortest path heuristic tables of chosen targets of one graph (depots, hubs), precomputed into a file that is
+// mapped in place. The tables hold the values ShortestPathHeuristic returns, so after opening the store a query
+// towards a stored target needs no setup. Like landmark files the store is only used with the graph it was
+// computed for (see graph_fingerprint).
+class HeuristicStore {
+private:
+    std::shared_ptr<MappedFile>             mapping;
+    size_t                                  graph_size = 0;
+    const Pair<Cost>                        *tables = nullptr;  // One after the other, graph_size+1 entries each
+    std::unordered_map<size_t, size_t>      slots;              // Of the targets' tables
+
+    friend class StoredHeuristic;
+
+public:
+    // Maps the store, fails on files written by an incompatible build or for another graph
+    bool open(std::string store_file, const AdjacencyMatrix &graph);
+    bool contains(size_t target) const;
+    size_t count(void) const;
+};
+
+// Computes the tables of `targets` of a graph from contraction hierarchies of its reverse, for both criteria
+// (see ContractionHierarchy::many_to_all), and writes them as a store
+bool save_heuristic_store(std::string store_file, const AdjacencyMatrix &graph, const std::vector<size_t> &targets,
+                          Pair<const ContractionHierarchy *> inv_hierarchies);
+
+
+// Heuristic served from the mapped table of a stored target, with the values of ShortestPathHeuristic.
+// Keeps the mapping alive, so it may outlive the store.
+class StoredHeuristic {
+private:
+    std::shared_ptr<MappedFile> mapping;
+    const Pair<Cost>            *table;
+
+public:
+    // The target must be in the store
+    StoredHeuristic(size_t target, const HeuristicStore &store);
+    Pair<Cost> operator()(size_t node_id);
+    // The same values through a view of the mapped table, valid while the store or a copy of the heuristic is alive
+    HeuristicTableView view(void) const;
+};
+
+#endif //EXAMPLE_HEURISTIC_STORE_H
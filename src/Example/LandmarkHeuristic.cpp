@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#include "LandmarkHeuristic.h"
+#include "../Utils/IndexedHeap.h"
+#include "../Utils/DeltaStepping.h"
+
+// Attempts at drawing a root before AVOID falls back to FARTHEST
+const size_t AVOID_ATTEMPTS = 8;
+
+// Landmark file layout: the header below, the landmark vertices (VertexId values, padded to a multiple
+// of 8 bytes) and the distances table. Like graph snapshots (see IOUtils.cpp) the header records the
+// value widths and byte order, plus the fingerprint of the graph the tables belong to.
+const char      LANDMARKS_MAGIC[8]      = {'P', 'P', 'G', 'L', 'M', 'A', 'R', 'K'};
+const uint32_t  LANDMARKS_VERSION       = 1;
+const uint32_t  LANDMARKS_BYTE_ORDER    = 0x01020304;
+const size_t    LANDMARKS_ALIGNMENT     = 8;
+
+struct LandmarksHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order;
+    uint32_t    vertex_id_size;
+    uint32_t    cost_size;
+    uint64_t    graph_size;
+    uint64_t    count;
+    uint64_t    fingerprint;
+};
+
+
+// Single criterion shortest paths from `source`, written to distances[v][cost_idx] and parents[v].
+// `order` (when given) receives the reached vertices in the order they were settled.
+void shortest_paths(const AdjacencyMatrix &graph, size_t source, size_t cost_idx, size_t threads,
+                    Pair<Cost> *distances, VertexId *parents, std::vector<VertexId> *order=nullptr) {
+    if ((threads > 1) && (order == nullptr)) {
+        delta_stepping(graph, source, cost_idx, threads, distances, parents);
+        return;
+    }
+
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        distances[vertex][cost_idx] = MAX_COST;
+        parents[vertex] = MAX_VERTEX_ID;
+    }
+    IndexedHeap open(graph.size()+1);
+    distances[source][cost_idx] = 0;
+    open.push_or_decrease(source, 0);
+
+    while (open.empty() == false) {
+        size_t vertex = open.pop();
+        Cost distance = distances[vertex][cost_idx];
+        if (order != nullptr) {
+            order->push_back((VertexId)vertex);
+        }
+        const AdjacencyMatrix::Neighbors outgoing_edges = graph[vertex];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+            Cost next_distance = distance + p_edge->cost[cost_idx];
+            if (next_distance < distances[p_edge->target][cost_idx]) {
+                distances[p_edge->target][cost_idx] = next_distance;
+                parents[p_edge->target] = (VertexId)vertex;
+                open.push_or_decrease(p_edge->target, next_distance);
+            }
+        }
+    }
+}
+
+
+// Best triangle inequality bound on the cost from `vertex` to `target` for one criterion, given the
+// entries of both in the landmark tables (to and from every landmark, see Landmarks). MAX_COST when
+// some landmark proves the target unreachable.
+Cost landmark_bound(const Pair<Cost> *vertex_distances, const Pair<Cost> *target_distances, size_t count,
+                    size_t cost_idx) {
+    Cost bound = 0;
+    for (size_t index = 0; index < 2*count; index += 2) {
+        Cost vertex_to = vertex_distances[index][cost_idx];
+        Cost target_to = target_distances[index][cost_idx];
+        Cost vertex_from = vertex_distances[index+1][cost_idx];
+        Cost target_from = target_distances[index+1][cost_idx];
+
+        // v -> t -> L is a path whenever v reaches t, the same goes for L -> v -> t
+        if (target_to != MAX_COST) {
+            if (vertex_to == MAX_COST) {
+                return MAX_COST;
+            }
+            bound = std::max(bound, (vertex_to > target_to) ? vertex_to - target_to : 0);
+        }
+        if (vertex_from != MAX_COST) {
+            if (target_from == MAX_COST) {
+                return MAX_COST;
+            }
+            bound = std::max(bound, (target_from > vertex_from) ? target_from - vertex_from : 0);
+        }
+    }
+    return bound;
+}
+
+
+Landmarks::Landmarks(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph, size_t count,
+                     Selection selection, size_t threads, unsigned seed)
+    : fingerprint(graph_fingerprint(graph)) {
+    if ((graph.size() != inv_graph.size()) || (graph.size() == 0)) {
+        throw std::invalid_argument("Landmarks need a non empty graph and its reverse");
+    }
+    count = std::min(count, graph.size());
+    this->distances.assign(2*(graph.size()+1)*count, Pair<Cost>({MAX_COST, MAX_COST}));
+    this->vertices.reserve(count);
+
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<size_t> random_vertex(1, graph.size());
+    while (this->vertices.size() < count) {
+        size_t landmark = MAX_VERTEX_ID;
+        for (size_t attempt = 0; (selection == Selection::AVOID) && (attempt < AVOID_ATTEMPTS); ++attempt) {
+            landmark = this->avoid_vertex(graph, random_vertex(random));
+            if (landmark != MAX_VERTEX_ID) {
+                break;
+            }
+        }
+        if (landmark == MAX_VERTEX_ID) {
+            landmark = this->farthest_vertex(graph, random_vertex(random));
+        }
+        if (landmark == MAX_VERTEX_ID) {
+            break; // Every vertex that can be reached already is a landmark
+        }
+        this->add_landmark(landmark, graph, inv_graph, threads);
+    }
+
+    // Fewer landmarks than asked for, compact the tables to the actual count
+    if (this->vertices.size() < count) {
+        HugePageVector<Pair<Cost>> compacted(2*(graph.size()+1)*this->vertices.size());
+        for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+            std::copy(this->distances.begin() + 2*vertex*count,
+                      this->distances.begin() + 2*(vertex*count + this->vertices.size()),
+                      compacted.begin() + 2*vertex*this->vertices.size());
+        }
+        this->distances.swap(compacted);
+    }
+}
+
+
+// The tables are sized for the final count, the new landmark takes the next free index
+void Landmarks::add_landmark(size_t landmark, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph,
+                             size_t threads) {
+    size_t stride = this->distances.size() / (2*(graph.size()+1));
+    size_t index = this->vertices.size();
+    HugePageVector<Pair<Cost>> landmark_distances(graph.size()+1);
+    HugePageVector<VertexId> parents(graph.size()+1);
+
+    // Costs to the landmark are searched on the reverse graph, costs from it on the graph
+    for (size_t direction = 0; direction < 2; ++direction) {
+        const AdjacencyMatrix &searched = (direction == 0) ? inv_graph : graph;
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            shortest_paths(searched, landmark, cost_idx, threads, landmark_distances.data(), parents.data());
+        }
+        for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+            this->distances[2*(vertex*stride + index) + direction] = landmark_distances[vertex];
+        }
+    }
+    this->vertices.push_back((VertexId)landmark);
+}
+
+
+// The reachable vertex farthest (first criterion) from `start`, or from the closest landmark once there are
+// landmarks. MAX_VERTEX_ID when all of them are landmarks already.
+size_t Landmarks::farthest_vertex(const AdjacencyMatrix &graph, size_t start) const {
+    size_t stride = this->distances.size() / (2*(graph.size()+1));
+    HugePageVector<Pair<Cost>> start_distances;
+    if (this->vertices.empty()) {
+        HugePageVector<VertexId> parents(graph.size()+1);
+        start_distances.resize(graph.size()+1);
+        shortest_paths(graph, start, 0, 1, start_distances.data(), parents.data());
+    }
+
+    size_t farthest = MAX_VERTEX_ID;
+    Cost farthest_distance = 0;
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        Cost distance = this->vertices.empty() ? start_distances[vertex][0] : MAX_COST;
+        for (size_t index = 0; index < this->vertices.size(); ++index) {
+            distance = std::min(distance, this->distances[2*(vertex*stride + index) + 1][0]);
+        }
+        if ((distance != MAX_COST) && (distance > farthest_distance)) {
+            farthest = vertex;
+            farthest_distance = distance;
+        }
+    }
+    return farthest;
+}
+
+
+// Avoid selection from a shortest path tree rooted at `root`: a vertex weighs the gap between its distance
+// from the root and the best landmark bound on it, subtrees that hold a landmark weigh nothing. Descends from
+// the root into the heaviest subtree down to a leaf. MAX_VERTEX_ID when every subtree of the root weighs nothing.
+size_t Landmarks::avoid_vertex(const AdjacencyMatrix &graph, size_t root) const {
+    size_t stride = this->distances.size() / (2*(graph.size()+1));
+    HugePageVector<Pair<Cost>> root_distances(graph.size()+1);
+    HugePageVector<VertexId> parents(graph.size()+1);
+    std::vector<VertexId> order;
+    shortest_paths(graph, root, 0, 1, root_distances.data(), parents.data(), &order);
+
+    std::vector<double> weights(graph.size()+1, 0);
+    std::vector<bool> holds_landmark(graph.size()+1, false);
+    for (auto landmark = this->vertices.begin(); landmark != this->vertices.end(); ++landmark) {
+        holds_landmark[*landmark] = true;
+    }
+    const Pair<Cost> *root_entries = &this->distances[2*root*stride];
+    for (auto p_vertex = order.begin(); p_vertex != order.end(); ++p_vertex) {
+        Cost bound = landmark_bound(root_entries, &this->distances[2*(*p_vertex)*stride], this->vertices.size(), 0);
+        Cost distance = root_distances[*p_vertex][0];
+        weights[*p_vertex] = (bound < distance) ? (double)(distance - bound) : 0;
+    }
+
+    // Settle order puts parents before children, so the subtree weights add up in reverse
+    for (auto p_vertex = order.rbegin(); p_vertex != order.rend(); ++p_vertex) {
+        if (holds_landmark[*p_vertex]) {
+            weights[*p_vertex] = 0;
+        }
+        VertexId parent = parents[*p_vertex];
+        if (parent != MAX_VERTEX_ID) {
+            weights[parent] += weights[*p_vertex];
+            holds_landmark[parent] = holds_landmark[parent] || holds_landmark[*p_vertex];
+        }
+    }
+
+    std::vector<size_t> child_offsets(graph.size()+2, 0);
+    for (auto p_vertex = order.begin(); p_vertex != order.end(); ++p_vertex) {
+        if (parents[*p_vertex] != MAX_VERTEX_ID) {
+            child_offsets[parents[*p_vertex]+1]++;
+        }
+    }
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        child_offsets[vertex+1] += child_offsets[vertex];
+    }
+    std::vector<VertexId> children(child_offsets[graph.size()+1]);
+    std::vector<size_t> next_child(child_offsets.begin(), child_offsets.end()-1);
+    for (auto p_vertex = order.begin(); p_vertex != order.end(); ++p_vertex) {
+        if (parents[*p_vertex] != MAX_VERTEX_ID) {
+            children[next_child[parents[*p_vertex]]++] = *p_vertex;
+        }
+    }
+
+    // The root itself usually sees a landmark somewhere below it, only its subtrees are weighed
+    size_t vertex = root;
+    while (true) {
+        size_t heaviest = MAX_VERTEX_ID;
+        for (size_t child = child_offsets[vertex]; child < child_offsets[vertex+1]; ++child) {
+            if ((weights[children[child]] > 0) &&
+                ((heaviest == MAX_VERTEX_ID) || (weights[children[child]] > weights[heaviest]))) {
+                heaviest = children[child];
+            }
+        }
+        if (heaviest == MAX_VERTEX_ID) {
+            return (vertex == root) ? MAX_VERTEX_ID : vertex;
+        }
+        vertex = heaviest;
+    }
+}
+
+
+size_t Landmarks::memory_usage() const {
+    return this->distances.size() * sizeof(Pair<Cost>) + this->vertices.size() * sizeof(VertexId);
+}
+
+
+uint64_t graph_fingerprint(const AdjacencyMatrix &graph) {
+    // splitmix64 finalizer per arc, summed so the order of the edges does not matter
+    auto mix = [](uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    };
+    uint64_t fingerprint = mix(graph.size());
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        const AdjacencyMatrix::Neighbors outgoing_edges = graph[vertex];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+            fingerprint += mix(mix(mix(vertex) + p_edge->target) + p_edge->cost[0]) ^ mix(p_edge->cost[1]);
+        }
+    }
+    return fingerprint;
+}
+
+
+bool save_landmarks(std::string landmarks_file, const Landmarks &landmarks) {
+    std::ofstream file(landmarks_file.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (file.is_open() == false) {
+        return false;
+    }
+
+    LandmarksHeader header = {};
+    std::copy(LANDMARKS_MAGIC, LANDMARKS_MAGIC+sizeof(LANDMARKS_MAGIC), header.magic);
+    header.version = LANDMARKS_VERSION;
+    header.byte_order = LANDMARKS_BYTE_ORDER;
+    header.vertex_id_size = sizeof(VertexId);
+    header.cost_size = sizeof(Cost);
+    header.count = landmarks.count();
+    header.graph_size = (header.count == 0) ? 0 : landmarks.distances.size() / (2*header.count) - 1;
+    header.fingerprint = landmarks.fingerprint;
+
+    const char padding[LANDMARKS_ALIGNMENT] = {};
+    size_t vertices_bytes = landmarks.vertices.size() * sizeof(VertexId);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(landmarks.vertices.data()), vertices_bytes);
+    file.write(padding, (LANDMARKS_ALIGNMENT - vertices_bytes % LANDMARKS_ALIGNMENT) % LANDMARKS_ALIGNMENT);
+    file.write(reinterpret_cast<const char *>(landmarks.distances.data()),
+               landmarks.distances.size() * sizeof(Pair<Cost>));
+    return file.good();
+}
+
+
+bool load_landmarks(std::string landmarks_file, const AdjacencyMatrix &graph, Landmarks &landmarks) {
+    std::ifstream file(landmarks_file.c_str(), std::ifstream::in | std::ifstream::binary);
+    LandmarksHeader header;
+    if ((file.is_open() == false) || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+    if ((std::equal(LANDMARKS_MAGIC, LANDMARKS_MAGIC+sizeof(LANDMARKS_MAGIC), header.magic) == false) ||
+        (header.version != LANDMARKS_VERSION) ||
+        (header.byte_order != LANDMARKS_BYTE_ORDER) ||
+        (header.vertex_id_size != sizeof(VertexId)) ||
+        (header.cost_size != sizeof(Cost)) ||
+        (header.count == 0) ||
+        (header.graph_size != graph.size()) ||
+        (header.fingerprint != graph_fingerprint(graph))) {
+        return false; // Incompatible build or stale tables
+    }
+
+    Landmarks loaded;
+    loaded.fingerprint = header.fingerprint;
+    loaded.vertices.resize(header.count);
+    loaded.distances.resize(2*(header.graph_size+1)*header.count);
+    size_t vertices_bytes = loaded.vertices.size() * sizeof(VertexId);
+    file.read(reinterpret_cast<char *>(loaded.vertices.data()), vertices_bytes);
+    file.ignore((LANDMARKS_ALIGNMENT - vertices_bytes % LANDMARKS_ALIGNMENT) % LANDMARKS_ALIGNMENT);
+    file.read(reinterpret_cast<char *>(loaded.distances.data()), loaded.distances.size() * sizeof(Pair<Cost>));
+    if (!file || (file.peek() != std::ifstream::traits_type::eof())) {
+        return false; // Truncated or corrupted file
+    }
+
+    landmarks = std::move(loaded);
+    return true;
+}
+
+
+LandmarkHeuristic::LandmarkHeuristic(size_t target, const Landmarks &landmarks)
+    : landmarks(landmarks), target_distances(2*landmarks.count()) {
+    for (size_t index = 0; index < landmarks.count(); ++index) {
+        this->target_distances[2*index] = landmarks.to_landmark(target, index);
+        this->target_distances[2*index+1] = landmarks.from_landmark(target, index);
+    }
+}
+
+
+Pair<Cost> LandmarkHeuristic::operator()(size_t node_id) {
+    size_t count = this->landmarks.count();
+    if (count == 0) {
+        return Pair<Cost>({0, 0});
+    }
+    const Pair<Cost> *node_distances = &this->landmarks.to_landmark(node_id, 0);
+    return Pair<Cost>({landmark_bound(node_distances, this->target_distances.data(), count, 0),
+                       landmark_bound(node_distances, this->target_distances.data(), count, 1)});
+}
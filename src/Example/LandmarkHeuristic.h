@@ -0,0 +1,79 @@
+#ifndef EXAMPLE_LANDMARK_HEURISTIC_H
+#define EXAMPLE_LANDMARK_HEURISTIC_H
+
+#include <string>
+#include <vector>
+#include "../Utils/Definitions.h"
+#include "../Utils/HugePages.h"
+
+
+// Shortest path costs between a few landmark vertices and every vertex of a graph, in both directions
+// and for both criteria (ALT, Goldberg and Harrelson). By the triangle inequality every path from v
+// to t costs at least d(v,L) - d(t,L) and d(L,t) - d(L,v), so the tables bound the cost towards any
+// target with no search per query. Computed once per graph and shared by all queries.
+class Landmarks {
+public:
+    // FARTHEST adds the vertex farthest from the landmarks picked so far. AVOID (Goldberg and Werneck)
+    // grows a shortest path tree from a random vertex and descends into the subtree whose paths the
+    // current landmarks bound worst, taking the leaf it ends at.
+    enum class Selection {FARTHEST, AVOID};
+
+private:
+    std::vector<VertexId>       vertices;
+    // Per vertex the costs to and then from every landmark: entries [2*(v*count + l)] and [2*(v*count + l)+1]
+    HugePageVector<Pair<Cost>>  distances;
+    uint64_t                    fingerprint = 0;      // Of the graph the tables belong to
+
+    void add_landmark(size_t landmark, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph,
+                      size_t threads);
+    size_t farthest_vertex(const AdjacencyMatrix &graph, size_t start) const;
+    size_t avoid_vertex(const AdjacencyMatrix &graph, size_t root) const;
+
+    friend bool save_landmarks(std::string landmarks_file, const Landmarks &landmarks);
+    friend bool load_landmarks(std::string landmarks_file, const AdjacencyMatrix &graph, Landmarks &landmarks);
+
+public:
+    Landmarks() = default;
+    // Picks `count` landmarks (vertices are drawn with the given seed) and searches from each of them
+    // on the graph and its reverse, with `threads` threads per search (see DeltaStepping.h)
+    Landmarks(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph, size_t count,
+              Selection selection=Selection::AVOID, size_t threads=1, unsigned seed=0);
+
+    size_t count(void) const { return this->vertices.size(); }
+    const std::vector<VertexId> &landmark_vertices(void) const { return this->vertices; }
+    // Cost of the shortest path from the vertex to landmark `index` and from the landmark to the vertex,
+    // per criterion, MAX_COST if there is none
+    const Pair<Cost> &to_landmark(size_t vertex, size_t index) const {
+        return this->distances[2*(vertex*this->count() + index)];
+    }
+    const Pair<Cost> &from_landmark(size_t vertex, size_t index) const {
+        return this->distances[2*(vertex*this->count() + index) + 1];
+    }
+    size_t memory_usage(void) const;
+};
+
+
+// Order independent hash of the arcs of a graph, stored tables are only used with the graph they were
+// computed on (a compressed or reordered copy has a different one)
+uint64_t graph_fingerprint(const AdjacencyMatrix &graph);
+
+// Landmark files hold the landmarks and their tables for one graph, so the preprocessing is paid once
+// per map. Loading fails on files written by an incompatible build or for another graph.
+bool save_landmarks(std::string landmarks_file, const Landmarks &landmarks);
+bool load_landmarks(std::string landmarks_file, const AdjacencyMatrix &graph, Landmarks &landmarks);
+
+
+// Admissible heuristic from the landmark tables: on call to operator() returns per criterion the best
+// triangle inequality bound over all landmarks in O(landmarks). The only setup per target is copying its
+// own table entries.
+class LandmarkHeuristic {
+private:
+    const Landmarks         &landmarks;
+    std::vector<Pair<Cost>> target_distances;   // The target's entries of the tables, same layout
+
+public:
+    LandmarkHeuristic(size_t target, const Landmarks &landmarks);
+    Pair<Cost> operator()(size_t node_id);
+};
+
+#endif // EXAMPLE_LANDMARK_HEURISTIC_H
@@ -0,0 +1,24 @@
+#include "QueryGraphs.h"
+
+
+void prepare_query_graphs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph,
+                          std::vector<std::pair<size_t, size_t>> &queries, bool reorder, bool simplify,
+                          VertexOrdering &ordering, GraphSimplification &simplification) {
+    // Search on a locality friendly numbering, queries are translated to it and logs back from it
+    if (reorder) {
+        ordering = bfs_ordering(graph, inv_graph);
+        graph = ordering.permute(graph);
+        inv_graph = ordering.permute(inv_graph);
+        ordering.translate_queries(queries);
+    }
+
+    // The query endpoints are kept, so every query can start and end on the simplified graph
+    if (simplify) {
+        std::vector<size_t> endpoints;
+        for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+            endpoints.push_back(iter->first);
+            endpoints.push_back(iter->second);
+        }
+        simplification = simplify_graphs(graph, inv_graph, endpoints);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef EXAMPLE_QUERY_GRAPHS_H
+#define EXAMPLE_QUERY_GRAPHS_H
+
+#include <utility>
+#include <vector>
+#include "../Utils/Definitions.h"
+#include "../Utils/GraphReordering.h"
+#include "../Utils/GraphSimplification.h"
+
+// Prepares the graphs of a map for searching its queries: renumbers the vertices in BFS order when `reorder`
+// is set (see GraphReordering.h), translating the queries to the new ids into `ordering`, then simplifies the
+// graphs when `simplify` is set, keeping the query endpoints (see GraphSimplification.h). run_queries and
+// tools/build_heuristic_store both prepare their graphs here, so files precomputed for the searched graph
+// (heuristic stores) match it when built with the same settings.
+void prepare_query_graphs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph,
+                          std::vector<std::pair<size_t, size_t>> &queries, bool reorder, bool simplify,
+                          VertexOrdering &ordering, GraphSimplification &simplification);
+
+#endif //EXAMPLE_QUERY_GRAPHS_H
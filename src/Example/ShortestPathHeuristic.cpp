@@ -1,8 +1,13 @@
 #include <limits>
 #include <memory>
 #include <algorithm>
+#include <queue>
+#include <thread>
+#include <stdexcept>
 
 #include "ShortestPathHeuristic.h"
+#include "../Utils/IndexedHeap.h"
+#include "../Utils/DeltaStepping.h"
 
 #include <errno.h>
 #include <stdint.h>
@@ -55,70 +60,212 @@ size_t float_rounded_to_size_t(float f) {
 }
 
 
-ShortestPathHeuristic::ShortestPathHeuristic(size_t source, size_t graph_size, const AdjacencyMatrix &adj_matrix)
-    : source(source), all_nodes(graph_size+1, nullptr) {
-    size_t i = 0;
-    for (auto node_iter = this->all_nodes.begin(); node_iter != this->all_nodes.end(); node_iter++) {
-        *node_iter = std::make_shared<Node>(i++, Pair<size_t>({0,0}), Pair<size_t>({MAX_COST,MAX_COST}), Pair<size_t>({1,1}));
+// Below this size starting threads costs more than the searches
+const size_t PARALLEL_MIN_VERTICES = 1 << 16;
+
+
+// Replaces the costs of a table by their heuristic values
+static void scale_to_heuristic(HugePageVector<Pair<Cost>> &table) {
+    for (auto entry = table.begin(); entry != table.end(); ++entry) {
+        *entry = Pair<Cost>{heuristic_value((*entry)[0]), heuristic_value((*entry)[1])};
     }
+}
+
 
-    compute(0, adj_matrix);
-    compute(1, adj_matrix);
+ShortestPathHeuristic::ShortestPathHeuristic(size_t source, size_t graph_size, const AdjacencyMatrix &adj_matrix,
+                                             size_t threads)
+    : source(source), tables(std::make_shared<Tables>()) {
+    HugePageVector<Pair<Cost>> &h = this->tables->h;
+    h.assign(graph_size+1, Pair<Cost>({MAX_COST, MAX_COST}));
+
+    if ((threads < 2) || (graph_size < PARALLEL_MIN_VERTICES)) {
+        compute(0, adj_matrix, h);
+        compute(1, adj_matrix, h);
+    } else {
+        // One criterion per half of the threads, they write disjoint halves of the table entries
+        std::thread second_criterion(&ShortestPathHeuristic::compute, this, 1, std::cref(adj_matrix), std::ref(h),
+                                     threads/2, nullptr);
+        compute(0, adj_matrix, h, threads - threads/2);
+        second_criterion.join();
+    }
+    scale_to_heuristic(h);
+}
+
+ShortestPathHeuristic::ShortestPathHeuristic(size_t source, Pair<const ContractionHierarchy *> hierarchies)
+    : source(source), tables(std::make_shared<Tables>()) {
+    if ((hierarchies[0]->criterion() != 0) || (hierarchies[1]->criterion() != 1) ||
+        (hierarchies[0]->size() != hierarchies[1]->size())) {
+        throw std::invalid_argument("Expected the hierarchies of both criteria of the same graph");
+    }
+
+    this->tables->h.resize(hierarchies[0]->size()+1);
+    hierarchies[0]->one_to_all(source, this->tables->h.data());
+    hierarchies[1]->one_to_all(source, this->tables->h.data());
+    scale_to_heuristic(this->tables->h);
 }
 
 //TODO change for different heuristic
-Pair<size_t> ShortestPathHeuristic::operator()(size_t node_id) {
-    size_t h1 = 0.9 * this->all_nodes[node_id]->h[0];
-    size_t h2 = 0.9 * this->all_nodes[node_id]->h[1];
-//    std::cout << "h1: " << this->all_nodes[node_id]->h[1] << ", h2: " << this->all_nodes[node_id]->h[2] << std::endl;
-//    std::cout << "h1_double: " << h1 << ", h2_double: " << h2 << std::endl;
-//    std::cout << "h1_t: " << (size_t)h1 << ", h2_t: " << (size_t)h2 << std::endl;
-
-    return Pair<size_t>{h1, h2};
-    //return this->all_nodes[node_id]->h;
+Pair<Cost> ShortestPathHeuristic::operator()(size_t node_id) {
+    return this->tables->h[node_id];
 }
 
 
-// Implements Dijkstra shortest path algorithm per cost_idx cost function
-void ShortestPathHeuristic::compute(size_t cost_idx, const AdjacencyMatrix &adj_matrix) {
-    // Init all heuristics to MAX_COST
-    for (auto node_iter = this->all_nodes.begin(); node_iter != this->all_nodes.end(); node_iter++) {
-        (*node_iter)->h[cost_idx] = MAX_COST;
-    }
+HeuristicTableView ShortestPathHeuristic::view() const {
+    return HeuristicTableView(this->tables->h.data());
+}
+
 
-    NodePtr node;
-    NodePtr next;
+size_t ShortestPathHeuristic::memory_usage() const {
+    return (this->tables->h.size() + this->tables->costs.size()) * sizeof(Pair<Cost>) +
+           (this->tables->parents[0].size() + this->tables->parents[1].size()) * sizeof(VertexId);
+}
 
-    // Init open heap
-    Node::more_than_specific_heurisitic_cost more_than(cost_idx);
-    std::vector<NodePtr> open;
-    std::make_heap(open.begin(), open.end(), more_than);
 
-    this->all_nodes[this->source]->h[cost_idx] = 0;
-    open.push_back(this->all_nodes[this->source]);
-    std::push_heap(open.begin(), open.end(), more_than);
+// Implements Dijkstra shortest path algorithm per cost_idx cost function.
+// The criteria have different settle orders, so each gets its own pass over the shared table.
+void ShortestPathHeuristic::compute(size_t cost_idx, const AdjacencyMatrix &adj_matrix,
+                                    HugePageVector<Pair<Cost>> &costs, size_t threads, VertexId *parents) {
+    if (threads > 1) {
+        delta_stepping(adj_matrix, this->source, cost_idx, threads, costs.data(), parents);
+        return;
+    }
+    if (parents != nullptr) {
+        std::fill(parents, parents + costs.size(), MAX_VERTEX_ID);
+    }
 
+    IndexedHeap open(costs.size());
+    costs[this->source][cost_idx] = 0;
+    open.push_or_decrease(this->source, 0);
 
     while (open.empty() == false) {
-        // Pop min from queue and process
-        std::pop_heap(open.begin(), open.end(), more_than);
-        node = open.back();
-        open.pop_back();
+        size_t vertex = open.pop();
+        Cost vertex_cost = costs[vertex][cost_idx];
 
         // Check to which neighbors we should extend the paths
-        const std::vector<Edge> &outgoing_edges = adj_matrix[node->id];
+        const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[vertex];
         for(auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
-            next = this->all_nodes[p_edge->target];
-
-            // Dominance check
-            if (next->h[cost_idx] <= (node->h[cost_idx]+p_edge->cost[cost_idx])) {
+            Cost next_cost = vertex_cost + p_edge->cost[cost_idx];
+            if (costs[p_edge->target][cost_idx] <= next_cost) {
                 continue;
             }
 
-            // If not dominated push to queue
-            next->h[cost_idx] = node->h[cost_idx] + p_edge->cost[cost_idx];
-            open.push_back(next);
-            std::push_heap(open.begin(), open.end(), more_than);
+            costs[p_edge->target][cost_idx] = next_cost;
+            if (parents != nullptr) {
+                parents[p_edge->target] = (VertexId)vertex;
+            }
+            open.push_or_decrease(p_edge->target, next_cost);
+        }
+    }
+}
+
+
+void ShortestPathHeuristic::update(const AdjacencyMatrix &adj_matrix, const AdjacencyMatrix &inv_adj_matrix,
+                                   const std::vector<CostUpdate> &updates) {
+    Tables &tables = *this->tables;
+    if (tables.costs.empty()) {
+        // Searched on the changed graph, nothing is left to repair
+        tables.costs.assign(tables.h.size(), Pair<Cost>({MAX_COST, MAX_COST}));
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            tables.parents[cost_idx].resize(tables.h.size());
+            compute(cost_idx, adj_matrix, tables.costs, 1, tables.parents[cost_idx].data());
+        }
+        tables.h = tables.costs;
+        scale_to_heuristic(tables.h);
+        return;
+    }
+
+    std::vector<size_t> changed;
+    for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+        repair(cost_idx, adj_matrix, inv_adj_matrix, updates, changed);
+    }
+    for (auto p_vertex = changed.begin(); p_vertex != changed.end(); ++p_vertex) {
+        const Pair<Cost> &vertex_costs = tables.costs[*p_vertex];
+        tables.h[*p_vertex] = Pair<Cost>{heuristic_value(vertex_costs[0]), heuristic_value(vertex_costs[1])};
+    }
+}
+
+
+// Incremental Dijkstra per cost_idx cost function (dynamic shortest paths in the style of Ramalingam and Reps):
+//  - the subtrees of the shortest path tree hanging below an arc that got costlier are invalidated
+//  - every invalidated vertex takes the best value offered by its valid in-neighbors
+//  - arcs that got cheaper are relaxed
+//  - a Dijkstra seeded with all of the above vertices settles the changes
+void ShortestPathHeuristic::repair(size_t cost_idx, const AdjacencyMatrix &adj_matrix,
+                                   const AdjacencyMatrix &inv_adj_matrix, const std::vector<CostUpdate> &updates,
+                                   std::vector<size_t> &changed) {
+    HugePageVector<VertexId> &parents = this->tables->parents[cost_idx];
+    HugePageVector<Pair<Cost>> &table = this->tables->costs;
+    auto h = [&table, cost_idx](size_t vertex) -> Cost& { return table[vertex][cost_idx]; };
+
+    std::vector<size_t> invalidated;
+    for (auto update = updates.begin(); update != updates.end(); ++update) {
+        if ((update->new_cost[cost_idx] <= update->old_cost[cost_idx]) || (parents[update->target] != update->source)) {
+            continue;
+        }
+
+        size_t first = invalidated.size();
+        invalidated.push_back(update->target);
+        parents[update->target] = MAX_VERTEX_ID;
+        for (size_t i = first; i < invalidated.size(); ++i) {
+            size_t vertex = invalidated[i];
+            h(vertex) = MAX_COST;
+            changed.push_back(vertex);
+            const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[vertex];
+            for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
+                if (parents[p_edge->target] == vertex) {
+                    parents[p_edge->target] = MAX_VERTEX_ID;
+                    invalidated.push_back(p_edge->target);
+                }
+            }
+        }
+    }
+
+    // Entries are (value, vertex), stale entries are skipped when popped
+    typedef std::pair<Cost, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+    for (auto p_vertex = invalidated.begin(); p_vertex != invalidated.end(); ++p_vertex) {
+        size_t vertex = *p_vertex;
+        const AdjacencyMatrix::Neighbors incoming_edges = inv_adj_matrix[vertex];
+        for (auto p_edge = incoming_edges.begin(); p_edge != incoming_edges.end(); p_edge++) {
+            Cost parent_h = h(p_edge->target);
+            if ((parent_h != MAX_COST) && (parent_h + p_edge->cost[cost_idx] < h(vertex))) {
+                h(vertex) = parent_h + p_edge->cost[cost_idx];
+                parents[vertex] = p_edge->target;
+            }
+        }
+        if (h(vertex) != MAX_COST) {
+            open.push({h(vertex), vertex});
+        }
+    }
+
+    for (auto update = updates.begin(); update != updates.end(); ++update) {
+        Cost source_h = h(update->source);
+        if ((update->new_cost[cost_idx] < update->old_cost[cost_idx]) && (source_h != MAX_COST) &&
+            (source_h + update->new_cost[cost_idx] < h(update->target))) {
+            h(update->target) = source_h + update->new_cost[cost_idx];
+            changed.push_back(update->target);
+            parents[update->target] = update->source;
+            open.push({h(update->target), update->target});
+        }
+    }
+
+    while (open.empty() == false) {
+        QueueEntry entry = open.top();
+        open.pop();
+        if (entry.first != h(entry.second)) {
+            continue;
+        }
+
+        const AdjacencyMatrix::Neighbors outgoing_edges = adj_matrix[entry.second];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
+            if (h(p_edge->target) <= entry.first + p_edge->cost[cost_idx]) {
+                continue;
+            }
+            h(p_edge->target) = entry.first + p_edge->cost[cost_idx];
+            changed.push_back(p_edge->target);
+            parents[p_edge->target] = entry.second;
+            open.push({h(p_edge->target), p_edge->target});
         }
     }
 }
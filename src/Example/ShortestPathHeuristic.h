@@ -2,19 +2,52 @@
 #define EXAMPLE_SHORTEST_PATH_HEURISTIC_H
 
 #include "../Utils/Definitions.h"
+#include "../Utils/HugePages.h"
+#include "../Utils/ContractionHierarchy.h"
 
 
 // Precalculates heuristic based on Dijkstra shortest paths algorithm.
 // On call to operator() returns the value of the heuristic in O(1)
+// With more than one thread (and a large enough graph) the two criteria are computed concurrently,
+// each by a parallel delta-stepping search (see DeltaStepping.h), the values are the same.
+// Given contraction hierarchies of the graph the table is filled by PHAST sweeps instead (see ContractionHierarchy.h),
+// again with the same values.
 class ShortestPathHeuristic {
 private:
+    // Flat per vertex tables, shared by copies of the heuristic (it is copied into std::bind)
+    struct Tables {
+        HugePageVector<Pair<Cost>>      h;          // Heuristic values (see heuristic_value) per criterion
+        // Only update() needs these, empty until the first update()
+        HugePageVector<Pair<Cost>>      costs;      // Shortest path cost from the source per criterion, MAX_COST if unreachable
+        Pair<HugePageVector<VertexId>>  parents;    // Shortest path tree per criterion, MAX_VERTEX_ID for none
+    };
+
     size_t                  source;
-    std::vector<NodePtr>    all_nodes;
+    std::shared_ptr<Tables> tables;
 
-    void compute(size_t cost_idx, const AdjacencyMatrix& adj_matrix);
+    // Fills the shortest path costs of one criterion into `costs` (MAX_COST entries), and the shortest path tree
+    // to `parents` unless it is null
+    void compute(size_t cost_idx, const AdjacencyMatrix& adj_matrix, HugePageVector<Pair<Cost>> &costs,
+                 size_t threads=1, VertexId *parents=nullptr);
+    // Appends the vertices whose costs changed to `changed`
+    void repair(size_t cost_idx, const AdjacencyMatrix &adj_matrix, const AdjacencyMatrix &inv_adj_matrix,
+                const std::vector<CostUpdate> &updates, std::vector<size_t> &changed);
 public:
-    ShortestPathHeuristic(size_t source, size_t graph_size, const AdjacencyMatrix &adj_matrix);
-    Pair<size_t> operator()(size_t node_id); //TODO change for different heuristic
+    ShortestPathHeuristic(size_t source, size_t graph_size, const AdjacencyMatrix &adj_matrix, size_t threads=1);
+    // hierarchies[i] is the hierarchy of adj_matrix for criterion i
+    ShortestPathHeuristic(size_t source, Pair<const ContractionHierarchy *> hierarchies);
+    Pair<Cost> operator()(size_t node_id); //TODO change for different heuristic
+    // The same values through a view of the table, valid while a copy of the heuristic is alive
+    HeuristicTableView view(void) const;
+    // Bytes of the tables, shared by all copies
+    size_t memory_usage(void) const;
+
+    // Brings the heuristic up to date after the costs of some arcs of adj_matrix changed (see update_edge_costs),
+    // `updates` are in the direction of adj_matrix and inv_adj_matrix is its reverse. Only the vertices whose
+    // shortest paths changed are searched again, the result is the same as computing the heuristic from scratch.
+    // The table only keeps the heuristic values, so the first update searches the costs and their tree again.
+    void update(const AdjacencyMatrix &adj_matrix, const AdjacencyMatrix &inv_adj_matrix,
+                const std::vector<CostUpdate> &updates);
 };
 
 #endif // EXAMPLE_SHORTEST_PATH_HEURISTIC_H
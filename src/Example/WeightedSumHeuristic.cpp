@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include "WeightedSumHeuristic.h"
+
+// Largest weight of a pair, the other one is scaled to it
+const double WEIGHT_SCALE = 1024;
+
+
+WeightedSumHeuristic::WeightedSumHeuristic(size_t target, const ShortestPathHeuristic &shortest_paths,
+                                           const AdjacencyMatrix &inv_adj_matrix)
+    : shortest_paths(shortest_paths), sums(std::make_shared<HugePageVector<uint64_t>>()) {
+    // Average arc costs put the criteria on a common scale (the +1 avoids dividing by zero)
+    Pair<double> total_costs = {{1, 1}};
+    for (size_t vertex = 0; vertex <= inv_adj_matrix.size(); ++vertex) {
+        const AdjacencyMatrix::Neighbors incoming_edges = inv_adj_matrix[vertex];
+        for (auto p_edge = incoming_edges.begin(); p_edge != incoming_edges.end(); p_edge++) {
+            total_costs[0] += p_edge->cost[0];
+            total_costs[1] += p_edge->cost[1];
+        }
+    }
+    for (size_t weight_idx = 0; weight_idx < WeightedSumTableView::WEIGHTS_COUNT; ++weight_idx) {
+        double lambda = (weight_idx + 1.0) / (WeightedSumTableView::WEIGHTS_COUNT + 1);
+        Pair<double> weights = {{lambda / total_costs[0], (1 - lambda) / total_costs[1]}};
+        double largest = std::max(weights[0], weights[1]);
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            this->weights[weight_idx][cost_idx] = std::max<uint64_t>(1, std::llround(WEIGHT_SCALE * weights[cost_idx] / largest));
+        }
+    }
+
+    this->sums->assign((inv_adj_matrix.size()+1) * WeightedSumTableView::WEIGHTS_COUNT,
+                       WeightedSumTableView::UNREACHABLE_SUM);
+    for (size_t weight_idx = 0; weight_idx < WeightedSumTableView::WEIGHTS_COUNT; ++weight_idx) {
+        compute(weight_idx, target, inv_adj_matrix);
+    }
+}
+
+
+// Dijkstra on the weighted sum of the costs. Sums may exceed Cost, so the keys are kept in a priority queue
+// of their own with stale entries skipped when popped. Sums saturate at UNREACHABLE_SUM, which is over every
+// checked bound.
+void WeightedSumHeuristic::compute(size_t weight_idx, size_t target, const AdjacencyMatrix &inv_adj_matrix) {
+    const size_t stride = WeightedSumTableView::WEIGHTS_COUNT;
+    const uint64_t unreachable = WeightedSumTableView::UNREACHABLE_SUM;
+    const uint64_t max_cost = WeightedSumTableView::MAX_CHECKED_BOUND;
+    const Pair<uint64_t> &w = this->weights[weight_idx];
+    uint64_t *sums = this->sums->data() + weight_idx;
+
+    typedef std::pair<uint64_t, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    sums[target*stride] = 0;
+    open.push({0, target});
+
+    while (open.empty() == false) {
+        QueueEntry entry = open.top();
+        open.pop();
+        if (entry.first != sums[entry.second*stride]) {
+            continue;
+        }
+
+        const AdjacencyMatrix::Neighbors outgoing_edges = inv_adj_matrix[entry.second];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
+            uint64_t arc_sum = ((p_edge->cost[0] < max_cost) && (p_edge->cost[1] < max_cost)) ?
+                               w[0]*p_edge->cost[0] + w[1]*p_edge->cost[1] : unreachable;
+            uint64_t next_sum = entry.first + arc_sum;
+            if (next_sum > unreachable) {
+                next_sum = unreachable;
+            }
+            if (sums[p_edge->target*stride] <= next_sum) {
+                continue;
+            }
+            sums[p_edge->target*stride] = next_sum;
+            open.push({next_sum, p_edge->target});
+        }
+    }
+}
+
+
+Pair<Cost> WeightedSumHeuristic::operator()(size_t node_id) {
+    return this->shortest_paths(node_id);
+}
+
+
+WeightedSumTableView WeightedSumHeuristic::view() const {
+    return WeightedSumTableView(this->shortest_paths.view(), this->sums->data(), this->weights);
+}
+
+
+size_t WeightedSumHeuristic::memory_usage() const {
+    return this->sums->size() * sizeof(uint64_t);
+}
@@ -0,0 +1,33 @@
+#ifndef EXAMPLE_WEIGHTED_SUM_HEURISTIC_H
+#define EXAMPLE_WEIGHTED_SUM_HEURISTIC_H
+
+#include <memory>
+#include "../Utils/Definitions.h"
+#include "../Utils/HugePages.h"
+#include "ShortestPathHeuristic.h"
+
+
+// Shortest path heuristic for bounded searches that also bounds weighted sums of the two criteria (the
+// Lagrangian relaxation of the pair of bound constraints), see WeightedSumTableView. On top of the two
+// single criterion searches, one Dijkstra per weight pair on w[0]*c1+w[1]*c2. When the criteria conflict the
+// cheapest paths of the two are far apart, and a node can be within each bound on its own but not within both.
+// The weight pairs split the criteria 1:3, 1:1 and 3:1, after scaling them by their average arc cost.
+class WeightedSumHeuristic {
+private:
+    ShortestPathHeuristic                       shortest_paths;
+    std::shared_ptr<HugePageVector<uint64_t>>   sums;       // WeightedSumTableView::WEIGHTS_COUNT per vertex, shared by copies
+    WeightedSumTableView::Weights               weights;
+
+    void compute(size_t weight_idx, size_t target, const AdjacencyMatrix &inv_adj_matrix);
+public:
+    // `shortest_paths` is the heuristic towards `target` over inv_adj_matrix, the reverse of the searched graph
+    WeightedSumHeuristic(size_t target, const ShortestPathHeuristic &shortest_paths, const AdjacencyMatrix &inv_adj_matrix);
+    // The values of the shortest path heuristic, the weighted sums are only checked through the view
+    Pair<Cost> operator()(size_t node_id);
+    // Valid while a copy of the heuristic is alive
+    WeightedSumTableView view(void) const;
+    // Bytes of the weighted sum tables, shared by all copies
+    size_t memory_usage(void) const;
+};
+
+#endif //EXAMPLE_WEIGHTED_SUM_HEURISTIC_H
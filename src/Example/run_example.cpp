@@ -1,15 +1,290 @@
 #include <iostream>
+#include <fstream>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <algorithm>
 
 #include "ShortestPathHeuristic.h"
+#include "GeometricHeuristic.h"
+#include "LandmarkHeuristic.h"
+#include "HeuristicCache.h"
+#include "BoundedShortestPathHeuristic.h"
+#include "HeuristicStore.h"
+#include "WeightedSumHeuristic.h"
+#include "QueryGraphs.h"
 #include "../Utils/Definitions.h"
 #include "../Utils/IOUtils.h"
 #include "../Utils/Logger.h"
+#include "../Utils/GraphReordering.h"
+#include "../Utils/GraphSimplification.h"
+#include "../Utils/GraphRegistry.h"
+#include "../Utils/HugePages.h"
+#include "../Utils/Numa.h"
+#include "../Utils/ContractionHierarchy.h"
 #include "../BiCriteria/BOAStar.h"
 #include "../BiCriteria/PPA.h"
 
 const std::string resource_path = "src/Example/Resources/";
 
+// Renumber the vertices of each map in BFS order before running queries (see GraphReordering.h)
+const bool reorder_vertices = true;
+// Contract degree 2 chains and drop dominated parallel arcs before searching (see GraphSimplification.h).
+// Off by default: the Pareto sets keep their costs, but ties may be broken by different paths and the
+// expanded/generated counts in the logs are those of the smaller graph.
+const bool simplify_graph = false;
+// Back the large per vertex arrays with 2MB pages (see HugePages.h), switch off to compare
+const bool use_huge_pages = true;
+// Bound the search with the coordinates of the map (.co file) instead of two Dijkstras per query
+const bool geometric_heuristic = false;
+// Bound the search with landmark tables (ALT) instead of two Dijkstras per query, the tables of a map are
+// computed once and kept next to it on disk (see LandmarkHeuristic.h)
+const bool landmark_heuristic = false;
+const size_t landmark_count = 16;
+// Fill the shortest path heuristic tables of run_queries by PHAST sweeps over contraction hierarchies of the map
+// instead of Dijkstras, the hierarchies are built once per map (see ContractionHierarchy.h)
+const bool contraction_hierarchies = false;
+// Search towards the targets of run_queries only as far as the query bound reaches (see BoundedShortestPathHeuristic.h).
+// The searches of a map are kept and resumed when the same target comes with a larger bound.
+const bool bounded_heuristic = false;
+// Serve the heuristics of run_queries from tables of the query targets precomputed into a file next to the map,
+// computed and written on the first run (see HeuristicStore.h). tools/build_heuristic_store writes the same file,
+// with its flags matching reorder_vertices and simplify_graph.
+const bool heuristic_store = false;
+// Search with the flat tables of shortest path heuristics through HeuristicTableView, so the lookups inline,
+// instead of through std::function (the fallback, and the only way for the other heuristics)
+const bool heuristic_table_views = true;
+// Also prune the searches of run_queries by lower bounds on weighted sums of the criteria, which rule out nodes
+// within each bound on its own but not within both (see WeightedSumHeuristic.h). Kept per target of a map.
+const bool weighted_sum_bounds = false;
+// Store the graphs delta/varint compressed (see AdjacencyMatrix::compress)
+const bool compress_graphs = false;
+// Store the arcs present in both directions once for the graph and its reverse (see share_symmetric_arcs)
+const bool share_symmetric_graphs = false;
+// Threads building the shortest path heuristic of a query (see ShortestPathHeuristic), 1 for the sequential Dijkstras.
+// The parallel build only pays off with idle cores, so it is chosen per machine with --heuristic-threads (see main).
+size_t heuristic_threads = 1;
+// Loaded maps are kept in memory up to this budget and reused across runs (see GraphRegistry.h)
+const size_t maps_memory_budget = (size_t)8 << 30;
+// Heuristic tables are kept in memory up to this budget and reused by every run towards the same target
+const size_t heuristics_memory_budget = (size_t)4 << 30;
+
+// Path of a map file in the resources, the gzip compressed file (name+".gz") when the plain one is missing
+std::string resource_file(std::string name) {
+    std::string file = resource_path+name;
+    if ((std::ifstream(file).is_open() == false) && (std::ifstream(file+".gz").is_open() == true)) {
+        return file+".gz";
+    }
+    return file;
+}
+
+// Loads the forward and reverse graphs of a map. A binary snapshot (see tools/gr_to_snapshot)
+// is mapped in place when available, otherwise the pair of .gr (or .gr.gz) files is parsed
+bool load_map(std::string map, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph) {
+    if (load_graph_snapshot(resource_path+"USA-road-"+map+".snapshot", graph, inv_graph) == true) {
+        return true;
+    }
+
+    return load_gr_graphs(resource_file("USA-road-d."+map+".gr"), resource_file("USA-road-t."+map+".gr"), graph, inv_graph);
+}
+
+GraphRegistry map_registry(load_map, maps_memory_budget);
+
+// Heuristics are cached per searched graph: the map name for the reordered and simplified graphs of
+// run_queries, a suffixed name for graphs searched with the ids of the files. Heuristics of graphs whose
+// costs change are never cached, updating them would change the tables other runs share.
+HeuristicCache heuristic_cache(heuristics_memory_budget);
+
+// The graphs run_queries searches for a map, prepared once with the queries translated to them
+struct QueryGraphs {
+    AdjacencyMatrix                         graph;
+    AdjacencyMatrix                         inv_graph;
+    std::vector<std::pair<size_t, size_t>>  queries;
+    VertexOrdering                          ordering;
+    GraphSimplification                     simplification;
+};
+// Prepared graphs of run_queries by map name, kept outside the registry budget like the hierarchies below
+std::map<std::string, std::shared_ptr<QueryGraphs>> map_query_graphs;
+// Contraction hierarchies per criterion of the reverse graphs searched by run_queries, by map name like the heuristics
+std::map<std::string, std::shared_ptr<Pair<ContractionHierarchy>>> map_hierarchies;
+// Bound limited heuristics per target of the last map searched by run_queries
+std::string bounded_heuristics_map;
+std::map<size_t, BoundedShortestPathHeuristic> bounded_heuristics;
+// Weighted sum heuristics per target of the last map searched by run_queries
+std::string weighted_sum_heuristics_map;
+std::map<size_t, WeightedSumHeuristic> weighted_sum_heuristics;
+
+// Takes the graphs of a map from the registry. The returned graphs are views over the shared read only
+// columns, the runs only ever replace them with transformed copies.
+bool get_map(std::string map, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph) {
+    MapGraphsPtr map_graphs = map_registry.get(map);
+    if (map_graphs == nullptr) {
+        return false;
+    }
+
+    graph = map_graphs->graph;
+    inv_graph = map_graphs->inv_graph;
+    return true;
+}
+
+// Returns the graphs and queries run_queries searches for a map, preparing them on first use (renumbered,
+// simplified and stored as set above), or nullptr if the map or its queries could not be loaded
+std::shared_ptr<QueryGraphs> get_query_graphs(std::string map) {
+    std::shared_ptr<QueryGraphs> &query_graphs = map_query_graphs[map];
+    if (query_graphs != nullptr) {
+        return query_graphs;
+    }
+
+    std::shared_ptr<QueryGraphs> prepared = std::make_shared<QueryGraphs>();
+    AdjacencyMatrix &graph = prepared->graph;
+    AdjacencyMatrix &inv_graph = prepared->inv_graph;
+    if (get_map(map, graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return nullptr;
+    }
+
+    if (load_queries(resource_path+"USA-road-"+map+"-queries", prepared->queries) == false) {
+        std::cout << "Failed to load queries file" << std::endl;
+        return nullptr;
+    }
+
+    // Queries are translated to the searched graph, solutions are translated back before logging
+    prepare_query_graphs(graph, inv_graph, prepared->queries, reorder_vertices, simplify_graph, prepared->ordering,
+                         prepared->simplification);
+    if (simplify_graph) {
+        std::cout << map << " graph simplified: " << prepared->simplification.contracted_vertices()
+                  << " vertices contracted, " << prepared->simplification.removed_edges() << " edges removed"
+                  << std::endl;
+    }
+
+    if (compress_graphs) {
+        size_t plain_memory = graph.memory_usage() + inv_graph.memory_usage();
+        graph = graph.compress();
+        inv_graph = inv_graph.compress();
+        size_t compressed_memory = graph.memory_usage() + inv_graph.memory_usage();
+        std::cout << map << " graph memory: " << plain_memory/(1<<20) << "MB, compressed: "
+                  << compressed_memory/(1<<20) << "MB" << std::endl;
+    } else if (share_symmetric_graphs) {
+        size_t plain_memory = graph.memory_usage() + inv_graph.memory_usage();
+        double symmetric_fraction = share_symmetric_arcs(graph, inv_graph);
+        size_t shared_memory = graph.memory_usage();
+        std::cout << map << " graph memory: " << plain_memory/(1<<20) << "MB, shared: "
+                  << shared_memory/(1<<20) << "MB (" << (int)(100*symmetric_fraction)
+                  << "% symmetric arcs)" << std::endl;
+    }
+
+    query_graphs = prepared;
+    return query_graphs;
+}
+
+// Loads the landmark tables of a searched graph from its file, or computes and stores them when the file is
+// missing or was written for another graph. `graph_name` tells the files of differently prepared graphs apart.
+void get_landmarks(std::string graph_name, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph,
+                   Landmarks &landmarks) {
+    std::string landmarks_file = resource_path+"USA-road-"+graph_name+".landmarks";
+    auto start_time = std::chrono::steady_clock::now();
+    if (load_landmarks(landmarks_file, graph, landmarks) == true) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        std::cout << graph_name << " landmarks loaded in " << elapsed.count() << "s" << std::endl;
+        return;
+    }
+
+    landmarks = Landmarks(graph, inv_graph, landmark_count, Landmarks::Selection::AVOID, heuristic_threads);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cout << graph_name << " " << landmarks.count() << " landmarks computed in " << elapsed.count() << "s, "
+              << landmarks.memory_usage()/(1<<20) << "MB" << std::endl;
+    if (save_landmarks(landmarks_file, landmarks) == false) {
+        std::cout << "Failed to save landmarks file" << std::endl;
+    }
+}
+
+// Returns the contraction hierarchies of the reverse graph searched for a map, building them on first use
+std::shared_ptr<Pair<ContractionHierarchy>> get_hierarchies(std::string graph_name, const AdjacencyMatrix &inv_graph) {
+    std::shared_ptr<Pair<ContractionHierarchy>> &hierarchies = map_hierarchies[graph_name];
+    if (hierarchies == nullptr) {
+        auto start_time = std::chrono::steady_clock::now();
+        hierarchies = std::make_shared<Pair<ContractionHierarchy>>();
+        (*hierarchies)[0] = ContractionHierarchy(inv_graph, 0);
+        (*hierarchies)[1] = ContractionHierarchy(inv_graph, 1);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        std::cout << graph_name << " contraction hierarchies built in " << elapsed.count() << "s: "
+                  << (*hierarchies)[0].shortcuts_count() << " and " << (*hierarchies)[1].shortcuts_count()
+                  << " shortcuts, " << ((*hierarchies)[0].memory_usage() + (*hierarchies)[1].memory_usage())/(1<<20)
+                  << "MB" << std::endl;
+    }
+    return hierarchies;
+}
+
+// Opens the heuristic store of a map, precomputing the tables of the query targets when there is no store
+// yet. A store written for another graph (other preparation settings) or build is left untouched.
+void get_heuristic_store(std::string graph_name, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph,
+                         const std::vector<std::pair<size_t, size_t>> &queries, HeuristicStore &store) {
+    std::string store_file = resource_path+"USA-road-"+graph_name+".heuristics";
+    auto start_time = std::chrono::steady_clock::now();
+    if (store.open(store_file, graph) == true) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        std::cout << graph_name << " heuristic store of " << store.count() << " targets opened in "
+                  << elapsed.count() << "s" << std::endl;
+        return;
+    }
+    if (std::ifstream(store_file).is_open() == true) {
+        std::cout << "Heuristic store " << store_file << " does not match the searched graph, searching without it"
+                  << std::endl;
+        return;
+    }
+
+    std::vector<size_t> targets;
+    for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+        targets.push_back(iter->second);
+    }
+    std::shared_ptr<Pair<ContractionHierarchy>> hierarchies = get_hierarchies(graph_name, inv_graph);
+    if ((save_heuristic_store(store_file, graph, targets, {{&(*hierarchies)[0], &(*hierarchies)[1]}}) == false) ||
+        (store.open(store_file, graph) == false)) {
+        std::cout << "Failed to save heuristic store" << std::endl;
+        return;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cout << graph_name << " heuristic store of " << store.count() << " targets computed in "
+              << elapsed.count() << "s" << std::endl;
+}
+
+// Returns a heuristic towards `target` that reaches the bound, resuming the search of an earlier query
+// when there is one. Only the heuristics of one map are kept.
+BoundedShortestPathHeuristic get_bounded_heuristic(std::string graph_name, size_t target,
+                                                   const AdjacencyMatrix &inv_graph, Pair<size_t> bound) {
+    if (graph_name != bounded_heuristics_map) {
+        bounded_heuristics.clear();
+        bounded_heuristics_map = graph_name;
+    }
+    auto heuristic = bounded_heuristics.find(target);
+    if (heuristic == bounded_heuristics.end()) {
+        return bounded_heuristics.emplace(target, BoundedShortestPathHeuristic(target, inv_graph, bound)).first->second;
+    }
+    heuristic->second.extend(inv_graph, bound);
+    return heuristic->second;
+}
+
+// Returns the weighted sum heuristic towards `target`, over the shortest path heuristic of the cache.
+// Only the heuristics of one map are kept.
+WeightedSumHeuristic get_weighted_sum_heuristic(std::string graph_name, size_t target, const AdjacencyMatrix &inv_graph,
+                                                std::shared_ptr<Pair<ContractionHierarchy>> hierarchies) {
+    if (graph_name != weighted_sum_heuristics_map) {
+        weighted_sum_heuristics.clear();
+        weighted_sum_heuristics_map = graph_name;
+    }
+    auto heuristic = weighted_sum_heuristics.find(target);
+    if (heuristic != weighted_sum_heuristics.end()) {
+        return heuristic->second;
+    }
+
+    ShortestPathHeuristic sp_heuristic = (hierarchies != nullptr) ?
+        heuristic_cache.get(graph_name, target, {{&(*hierarchies)[0], &(*hierarchies)[1]}}) :
+        heuristic_cache.get(graph_name, target, inv_graph, heuristic_threads);
+    return weighted_sum_heuristics.emplace(target, WeightedSumHeuristic(target, sp_heuristic, inv_graph)).first->second;
+}
+
 // Simple example to demonstarte the usage of the algorithm
 void single_run_ny_map(size_t source, size_t target, double eps, LoggerPtr logger) {
 //    size_t a = 10;
@@ -18,23 +293,20 @@ void single_run_ny_map(size_t source, size_t target, double eps, LoggerPtr logge
 //    std::cout << d << std::endl;
     std::cout << "-----Start NY Map Single Example: SRC=" << source << " DEST=" << target << " EPS=" << eps << "-----" << std::endl;
 
-    // Load files
-    size_t graph_size;
-    std::vector<Edge> edges;
-    if (load_gr_files(resource_path+"USA-road-d.NE.gr", resource_path+"USA-road-t.NE.gr", edges, graph_size) == false) {
+    // Load graphs
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (get_map("NE", graph, inv_graph) == false) {
         std::cout << "Failed to load gr files" << std::endl;
         return;
     }
+    size_t graph_size = graph.size();
 
     std::cout << "Graph Size: " << graph_size << std::endl;
 
-    // Build graphs
-    AdjacencyMatrix graph(graph_size, edges);
-    AdjacencyMatrix inv_graph(graph_size, edges, true);
-
     // Compute heuristic
     std::cout << "Start Computing Heuristic" << std::endl;
-    ShortestPathHeuristic sp_heuristic(target, graph_size, inv_graph);
+    ShortestPathHeuristic sp_heuristic(target, graph_size, inv_graph, heuristic_threads);
     std::cout << "Finish Computing Heuristic\n" << std::endl;
 
     using std::placeholders::_1;
@@ -75,23 +347,45 @@ void single_run_ny_map(size_t source, size_t target, double eps, LoggerPtr logge
 void run_queries(std::string map, double eps, LoggerPtr logger, Pair<size_t> bound, int decider = 1) {
     std::cout << "-----Start " << map << " Map Queries Example: BOUND=" << bound << "-----" << std::endl;
 
-    // Load files
-    size_t graph_size;
-    std::vector<Edge> edges;
-    if (load_gr_files(resource_path+"USA-road-d."+map+".gr", resource_path+"USA-road-t."+map+".gr", edges, graph_size) == false) {
-        std::cout << "Failed to load gr files" << std::endl;
+    // Load graphs, prepared for searching on the first run of the map
+    std::shared_ptr<QueryGraphs> query_graphs = get_query_graphs(map);
+    if (query_graphs == nullptr) {
         return;
     }
-
-    std::vector<std::pair<size_t, size_t>> queries;
-    if (load_queries(resource_path+"USA-road-"+map+"-queries", queries) == false) {
-        std::cout << "Failed to load queries file" << std::endl;
-        return;
+    const AdjacencyMatrix &graph = query_graphs->graph;
+    const AdjacencyMatrix &inv_graph = query_graphs->inv_graph;
+    const std::vector<std::pair<size_t, size_t>> &queries = query_graphs->queries;
+    const VertexOrdering &ordering = query_graphs->ordering;
+    const GraphSimplification &simplification = query_graphs->simplification;
+
+    HugePageStats page_stats = huge_page_stats();
+    std::cout << map << " huge pages " << (huge_pages_enabled() ? "enabled" : "disabled") << ": "
+              << page_stats.hugetlb_bytes/(1<<20) << "MB explicit, " << page_stats.advised_bytes/(1<<20)
+              << "MB advised, " << page_stats.transparent_bytes/(1<<20) << "MB backed by transparent huge pages, "
+              << page_stats.heap_bytes/(1<<20) << "MB left on the heap" << std::endl;
+
+    // Geometric bounds need no search per query, the embedding is computed once and shared by all of them
+    std::unique_ptr<GeometricEmbedding> embedding;
+    if (geometric_heuristic) {
+        std::vector<Pair<double>> coordinates;
+        if (load_co_file(resource_file("USA-road-d."+map+".co"), coordinates) == false) {
+            std::cout << "Failed to load co file" << std::endl;
+            return;
+        }
+        embedding.reset(new GeometricEmbedding(graph, ordering.permute(coordinates)));
+    }
+    Landmarks landmarks;
+    if (landmark_heuristic) {
+        get_landmarks(map, graph, inv_graph, landmarks);
+    }
+    HeuristicStore store;
+    if (heuristic_store) {
+        get_heuristic_store(map, graph, inv_graph, queries, store);
+    }
+    std::shared_ptr<Pair<ContractionHierarchy>> hierarchies;
+    if (contraction_hierarchies) {
+        hierarchies = get_hierarchies(map, inv_graph);
     }
-
-    // Build graphs
-    AdjacencyMatrix graph(graph_size, edges);
-    AdjacencyMatrix inv_graph(graph_size, edges, true);
 
     size_t query_count = 0;
     for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
@@ -102,23 +396,323 @@ void run_queries(std::string map, double eps, LoggerPtr logger, Pair<size_t> bou
         size_t source = iter->first;
         size_t target = iter->second;
 
-        ShortestPathHeuristic sp_heuristic(target, graph_size, inv_graph);
-
         using std::placeholders::_1;
-        Heuristic heuristic = std::bind( &ShortestPathHeuristic::operator(), sp_heuristic, _1);
+        Heuristic heuristic;
+        // Set for heuristics with a flat table, the table is kept alive by the copy in `heuristic`
+        HeuristicTableView table_view;
+        WeightedSumTableView weighted_sum_view;
+        if (embedding != nullptr) {
+            GeometricHeuristic geo_heuristic(target, *embedding);
+            heuristic = std::bind( &GeometricHeuristic::operator(), geo_heuristic, _1);
+        } else if (landmark_heuristic) {
+            LandmarkHeuristic alt_heuristic(target, landmarks);
+            heuristic = std::bind( &LandmarkHeuristic::operator(), alt_heuristic, _1);
+        } else if (store.contains(target)) {
+            StoredHeuristic stored_heuristic(target, store);
+            heuristic = std::bind( &StoredHeuristic::operator(), stored_heuristic, _1);
+            table_view = stored_heuristic.view();
+        } else if (bounded_heuristic) {
+            BoundedShortestPathHeuristic bounded_sp_heuristic = get_bounded_heuristic(map, target, inv_graph, bound);
+            heuristic = std::bind( &BoundedShortestPathHeuristic::operator(), bounded_sp_heuristic, _1);
+        } else if (weighted_sum_bounds) {
+            WeightedSumHeuristic ws_heuristic = get_weighted_sum_heuristic(map, target, inv_graph, hierarchies);
+            heuristic = std::bind( &WeightedSumHeuristic::operator(), ws_heuristic, _1);
+            weighted_sum_view = ws_heuristic.view();
+        } else if (hierarchies != nullptr) {
+            ShortestPathHeuristic sp_heuristic = heuristic_cache.get(map, target, {{&(*hierarchies)[0], &(*hierarchies)[1]}});
+            heuristic = std::bind( &ShortestPathHeuristic::operator(), sp_heuristic, _1);
+            table_view = sp_heuristic.view();
+        } else {
+            ShortestPathHeuristic sp_heuristic = heuristic_cache.get(map, target, inv_graph, heuristic_threads);
+            heuristic = std::bind( &ShortestPathHeuristic::operator(), sp_heuristic, _1);
+            table_view = sp_heuristic.view();
+        }
 
         SolutionSet boa_solutions;
         BOAStar boa_star(graph, {eps,eps},bound, logger);
-        boa_star(source, target, heuristic, boa_solutions, bound, decider);
+        boa_star.set_vertex_ordering(&ordering);
+        boa_star.set_graph_simplification(&simplification);
+        if (weighted_sum_view.is_valid()) {
+            boa_star(source, target, weighted_sum_view, boa_solutions, bound, decider);
+        } else if (heuristic_table_views && table_view.is_valid()) {
+            boa_star(source, target, table_view, boa_solutions, bound, decider);
+        } else {
+            boa_star(source, target, heuristic, boa_solutions, bound, decider);
+        }
 //        SolutionSet ppa_solutions;
 //        PPA ppa(graph, {eps,eps}, logger);
 //        ppa(source, target, heuristic, ppa_solutions);
     }
 
+    HeuristicCache::Stats cache_stats = heuristic_cache.stats();
+    std::cout << "Heuristic cache: " << cache_stats.hits << " hits, " << cache_stats.misses << " misses, "
+              << cache_stats.evictions << " evictions, " << heuristic_cache.memory_usage()/(1<<20) << "MB" << std::endl;
     std::cout << "-----End " << map << " Map Queries Example-----" << std::endl;
 }
 
 
+// Runs the queries of a map concurrently with one worker per CPU. On multi socket machines the
+// workers of every NUMA node are bound to it and search the node's own replica of the graphs.
+// Searches are not logged (the logger is not thread safe), only a summary is printed.
+void run_queries_batch(std::string map, double eps, Pair<size_t> bound, int decider = 1) {
+    std::cout << "-----Start " << map << " Map Batch Queries: BOUND=" << bound << "-----" << std::endl;
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (get_map(map, graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return;
+    }
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    if (load_queries(resource_path+"USA-road-"+map+"-queries", queries) == false) {
+        std::cout << "Failed to load queries file" << std::endl;
+        return;
+    }
+
+    NumaGraphReplicas replicas(graph, inv_graph);
+    const std::vector<NumaNode> &nodes = replicas.numa_nodes();
+    std::cout << map << " graph replicas: " << nodes.size() << " NUMA node(s)" << std::endl;
+
+    // Every worker takes the next unprocessed query
+    std::atomic<size_t> next_query(0);
+    std::atomic<size_t> solved_queries(0);
+    auto start_time = std::chrono::steady_clock::now();
+    run_on_numa_cpus(nodes, [&](size_t node_index) {
+        const AdjacencyMatrix &local_graph = replicas.graph(node_index);
+        const AdjacencyMatrix &local_inv_graph = replicas.inv_graph(node_index);
+        for (size_t query = next_query++; query < queries.size(); query = next_query++) {
+            size_t source = queries[query].first;
+            size_t target = queries[query].second;
+
+            // One thread per query, the workers already keep every CPU busy. Tables are cached per node, so
+            // the workers of a node read the ones computed there, in its local memory.
+            ShortestPathHeuristic sp_heuristic =
+                heuristic_cache.get(map+":loaded:"+std::to_string(node_index), target, local_inv_graph);
+
+            SolutionSet boa_solutions;
+            BOAStar boa_star(local_graph, {eps,eps}, bound);
+            if (heuristic_table_views) {
+                HeuristicTableView table_view = sp_heuristic.view();
+                boa_star(source, target, table_view, boa_solutions, bound, decider);
+            } else {
+                using std::placeholders::_1;
+                Heuristic heuristic = std::bind( &ShortestPathHeuristic::operator(), sp_heuristic, _1);
+                boa_star(source, target, heuristic, boa_solutions, bound, decider);
+            }
+            if (boa_solutions.empty() == false) {
+                solved_queries++;
+            }
+        }
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << "Solved " << solved_queries << "/" << queries.size() << " queries in " << elapsed.count()
+              << "s" << std::endl;
+    std::cout << "-----End " << map << " Map Batch Queries-----" << std::endl;
+}
+
+
+// Simulates a batch of travel time changes on a map (a random sample of arcs gets between half and twice
+// its time) and compares absorbing it into the heuristics of the query targets with recomputing them.
+void run_cost_updates(std::string map, size_t batch_size) {
+    std::cout << "-----Start " << map << " Map Cost Updates: BATCH=" << batch_size << "-----" << std::endl;
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (get_map(map, graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return;
+    }
+    size_t graph_size = graph.size();
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    if (load_queries(resource_path+"USA-road-"+map+"-queries", queries) == false) {
+        std::cout << "Failed to load queries file" << std::endl;
+        return;
+    }
+
+    // The graphs change below and the heuristics are updated in place, so they are kept out of the shared cache
+    std::vector<ShortestPathHeuristic> heuristics;
+    for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+        heuristics.push_back(ShortestPathHeuristic(iter->second, graph_size, inv_graph, heuristic_threads));
+    }
+
+    std::mt19937 random(0);
+    std::uniform_int_distribution<size_t> random_vertex(1, graph_size);
+    std::uniform_real_distribution<double> random_factor(0.5, 2);
+    std::vector<Edge> updates;
+    while (updates.size() < batch_size) {
+        size_t source = random_vertex(random);
+        AdjacencyMatrix::Neighbors edges = graph[source];
+        if (edges.empty()) {
+            continue;
+        }
+        auto p_edge = edges.begin();
+        for (size_t skip = random() % edges.size(); skip > 0; --skip) {
+            ++p_edge;
+        }
+        Pair<Cost> cost = p_edge->cost;
+        cost[1] = std::max<Cost>(1, cost[1] * random_factor(random));
+        updates.push_back(Edge((VertexId)source, p_edge->target, cost));
+    }
+
+    // The heuristics are computed on the reverse graph, so they get the changes reversed
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<CostUpdate> changes;
+    if (update_edge_costs(graph, inv_graph, updates, changes) == false) {
+        std::cout << "Updated path costs do not fit " << COST_WIDTH << " bit costs" << std::endl;
+        return;
+    }
+    std::vector<CostUpdate> inv_changes;
+    for (auto change = changes.begin(); change != changes.end(); ++change) {
+        inv_changes.push_back(change->inverse());
+    }
+    for (auto heuristic = heuristics.begin(); heuristic != heuristics.end(); ++heuristic) {
+        heuristic->update(inv_graph, graph, inv_changes);
+    }
+    std::chrono::duration<double> update_time = std::chrono::steady_clock::now() - start_time;
+
+    start_time = std::chrono::steady_clock::now();
+    for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+        ShortestPathHeuristic sp_heuristic(iter->second, graph_size, inv_graph, heuristic_threads);
+    }
+    std::chrono::duration<double> recompute_time = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << changes.size() << " arcs changed, " << heuristics.size() << " heuristics updated in "
+              << update_time.count() << "s (recomputing them takes " << recompute_time.count() << "s)" << std::endl;
+    std::cout << "-----End " << map << " Map Cost Updates-----" << std::endl;
+}
+
+
+// Runs the queries of a map with the shortest path heuristic and with the landmark heuristic, and compares
+// the nodes expanded and the time per query including the setup of the heuristic (no caching for either).
+void run_landmark_comparison(std::string map, Pair<size_t> bound, int decider = 1) {
+    std::cout << "-----Start " << map << " Map Landmark Comparison: BOUND=" << bound << "-----" << std::endl;
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (get_map(map, graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return;
+    }
+    size_t graph_size = graph.size();
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    if (load_queries(resource_path+"USA-road-"+map+"-queries", queries) == false) {
+        std::cout << "Failed to load queries file" << std::endl;
+        return;
+    }
+
+    Landmarks landmarks;
+    get_landmarks(map+"-loaded", graph, inv_graph, landmarks);
+
+    using std::placeholders::_1;
+    Pair<size_t> expanded = {0, 0};
+    Pair<double> setup_time = {0, 0};
+    Pair<double> search_time = {0, 0};
+    for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+        for (size_t variant = 0; variant < 2; ++variant) {
+            auto start_time = std::chrono::steady_clock::now();
+            Heuristic heuristic;
+            if (variant == 0) {
+                ShortestPathHeuristic sp_heuristic(iter->second, graph_size, inv_graph, heuristic_threads);
+                heuristic = std::bind( &ShortestPathHeuristic::operator(), sp_heuristic, _1);
+            } else {
+                LandmarkHeuristic alt_heuristic(iter->second, landmarks);
+                heuristic = std::bind( &LandmarkHeuristic::operator(), alt_heuristic, _1);
+            }
+            auto search_start_time = std::chrono::steady_clock::now();
+
+            SolutionSet boa_solutions;
+            BOAStar boa_star(graph, {0,0}, bound);
+            boa_star(iter->first, iter->second, heuristic, boa_solutions, bound, decider);
+            auto end_time = std::chrono::steady_clock::now();
+
+            expanded[variant] += boa_star.expanded_nodes();
+            setup_time[variant] += std::chrono::duration<double>(search_start_time - start_time).count();
+            search_time[variant] += std::chrono::duration<double>(end_time - search_start_time).count();
+        }
+    }
+
+    std::string names[2] = {"Shortest path", "Landmarks"};
+    for (size_t variant = 0; variant < 2; ++variant) {
+        std::cout << names[variant] << ": " << expanded[variant] << " nodes expanded, " << setup_time[variant]
+                  << "s setup + " << search_time[variant] << "s search over " << queries.size() << " queries"
+                  << std::endl;
+    }
+    std::cout << "-----End " << map << " Map Landmark Comparison-----" << std::endl;
+}
+
+
+// Compares the throughput of heuristic tables for many targets of a map: one Dijkstra per target and
+// criterion, one PHAST sweep per target, and PHAST sweeps over batches of targets (see ContractionHierarchy.h)
+// that give one interleaved table per batch and criterion
+void run_batched_tables(std::string map, size_t targets_count) {
+    std::cout << "-----Start " << map << " Map Batched Tables: TARGETS=" << targets_count << "-----" << std::endl;
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (get_map(map, graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return;
+    }
+    size_t vertices_count = graph.size()+1;
+
+    std::vector<size_t> targets;
+    std::mt19937 generator(0);
+    std::uniform_int_distribution<size_t> vertex_distribution(1, graph.size());
+    for (size_t index = 0; index < targets_count; ++index) {
+        targets.push_back(vertex_distribution(generator));
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    Pair<ContractionHierarchy> hierarchies = {{ContractionHierarchy(inv_graph, 0), ContractionHierarchy(inv_graph, 1)}};
+    std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - start_time;
+
+    start_time = std::chrono::steady_clock::now();
+    for (auto target = targets.begin(); target != targets.end(); ++target) {
+        ShortestPathHeuristic sp_heuristic(*target, graph.size(), inv_graph);
+    }
+    std::chrono::duration<double> dijkstra_time = std::chrono::steady_clock::now() - start_time;
+
+    start_time = std::chrono::steady_clock::now();
+    HugePageVector<Pair<Cost>> table(vertices_count);
+    for (auto target = targets.begin(); target != targets.end(); ++target) {
+        hierarchies[0].one_to_all(*target, table.data());
+        hierarchies[1].one_to_all(*target, table.data());
+    }
+    std::chrono::duration<double> sequential_time = std::chrono::steady_clock::now() - start_time;
+
+    start_time = std::chrono::steady_clock::now();
+    const size_t batch_size = ContractionHierarchy::BATCH_SIZE;
+    Pair<HugePageVector<Cost>> batch_tables = {{HugePageVector<Cost>(vertices_count*batch_size),
+                                                HugePageVector<Cost>(vertices_count*batch_size)}};
+    size_t mismatches = 0;
+    for (size_t first = 0; first < targets.size(); first += batch_size) {
+        std::vector<size_t> batch(targets.begin() + first, targets.begin() + std::min(first + batch_size, targets.size()));
+        hierarchies[0].many_to_all(batch, batch_tables[0].data());
+        hierarchies[1].many_to_all(batch, batch_tables[1].data());
+        // Spot check against the last single table
+        if (first + batch.size() == targets.size()) {
+            for (size_t vertex = 0; vertex < vertices_count; ++vertex) {
+                for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+                    mismatches += (batch_tables[cost_idx][vertex*batch_size + batch.size()-1] != table[vertex][cost_idx]);
+                }
+            }
+        }
+    }
+    std::chrono::duration<double> batched_time = std::chrono::steady_clock::now() - start_time;
+
+    std::cout << "Hierarchies built in " << build_time.count() << "s" << std::endl;
+    std::cout << "Dijkstra: " << targets_count/dijkstra_time.count() << " targets/s" << std::endl;
+    std::cout << "PHAST: " << targets_count/sequential_time.count() << " targets/s" << std::endl;
+    std::cout << "Batched PHAST (" << batch_size << " lanes): " << targets_count/batched_time.count()
+              << " targets/s, " << mismatches << " mismatches" << std::endl;
+    std::cout << "-----End " << map << " Map Batched Tables-----" << std::endl;
+}
+
+
 // Run all queries on all availible maps. The logs outputed from this function are
 // used for running the tests
 void run_all_queries(void) {
@@ -176,7 +770,27 @@ void run_all_queries(void) {
 }
 
 
-int main(void) {
+// Usage: run_example [--heuristic-threads=N], N threads build each heuristic table (0 for one per CPU)
+int main(int argc, char **argv) {
+    const std::string threads_flag = "--heuristic-threads=";
+    bool valid_flags = true;
+    for (int arg = 1; arg < argc; ++arg) {
+        std::string flag = argv[arg];
+        std::string value = flag.substr(std::min(flag.size(), threads_flag.size()));
+        if ((flag.compare(0, threads_flag.size(), threads_flag) == 0) && (value.empty() == false) &&
+            (value.size() <= 4) && (value.find_first_not_of("0123456789") == std::string::npos)) {
+            heuristic_threads = std::stoul(value);
+            if (heuristic_threads == 0) {
+                heuristic_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+        } else {
+            valid_flags = false;
+        }
+    }
+    if (valid_flags == false) {
+        std::cout << "Usage: " << argv[0] << " [--heuristic-threads=N]" << std::endl;
+        return 1;
+    }
 
     //    LoggerPtr logger = new Logger("example_log.json");
 //    // Easy - Benchmark C_BOA code gets around 20ms
@@ -190,6 +804,19 @@ int main(void) {
 //    single_run_ny_map(hard_source, hard_target, 0, logger);
 //    delete logger;
 
+//    // Concurrent batch, NUMA aware on multi socket machines
+//    run_queries_batch("NE", 0, Pair<size_t>({3350000,3350000}));
+
+//    // Live travel time changes absorbed by the heuristics
+//    run_cost_updates("NE", 1000);
+
+//    // Landmark (ALT) bounds against the two Dijkstras per query
+//    run_landmark_comparison("NE", Pair<size_t>({3350000,3350000}));
+
+//    // Heuristic tables for many targets in batches
+//    run_batched_tables("NE", 256);
+
+     set_huge_pages_enabled(use_huge_pages);
      try {
          run_all_queries();
      } catch (const std::exception &e) {
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include "ContractionHierarchy.h"
+#include "IndexedHeap.h"
+
+namespace {
+
+// Vertices a witness search may settle when contracting and when estimating the cost of contracting.
+// A search that gives up only adds a shortcut that was not needed, never drops a needed one.
+const size_t CONTRACTION_SETTLE_LIMIT = 200;
+const size_t ESTIMATE_SETTLE_LIMIT = 30;
+// Contraction stops once the remaining vertices have this many arcs each on average. What is left is the
+// top of the hierarchy, dense on graphs without a good hierarchy (grids), where contracting costs the
+// most for the least: its vertices are kept as a core that the upward search covers with all its arcs.
+const size_t CORE_AVERAGE_DEGREE = 32;
+
+
+struct DynamicArc {
+    VertexId    vertex;
+    Cost        cost;
+};
+
+
+// The graph during contraction: only the arcs between vertices not contracted yet are kept
+class Contraction {
+private:
+    std::vector<std::vector<DynamicArc>> outgoing;
+    std::vector<std::vector<DynamicArc>> incoming;
+    size_t                              arcs = 0;
+    std::vector<size_t>                 contracted_neighbours;
+    std::vector<size_t>                 levels;
+    // Witness searches, reset through `reached` after every search
+    IndexedHeap                         open;
+    std::vector<Cost>                   distances;
+    std::vector<VertexId>               reached;
+    std::vector<bool>                   is_target;
+
+    // Returns whether the arc is new, a parallel arc keeps the lower cost
+    static bool set_arc(std::vector<DynamicArc> &arcs, size_t vertex, Cost cost) {
+        for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+            if (arc->vertex == vertex) {
+                arc->cost = std::min(arc->cost, cost);
+                return false;
+            }
+        }
+        arcs.push_back({(VertexId)vertex, cost});
+        return true;
+    }
+
+    static void remove_arc(std::vector<DynamicArc> &arcs, size_t vertex) {
+        for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+            if (arc->vertex == vertex) {
+                *arc = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Dijkstra from `source` that does not pass through `avoided`, up to `max_cost` or `limit` settled vertices.
+    // Stops early once the `targets` vertices marked in is_target are all settled.
+    void witness_search(size_t source, size_t avoided, Cost max_cost, size_t limit, size_t targets) {
+        for (auto p_vertex = this->reached.begin(); p_vertex != this->reached.end(); ++p_vertex) {
+            this->distances[*p_vertex] = MAX_COST;
+        }
+        this->reached.clear();
+        this->open.clear();
+
+        this->distances[source] = 0;
+        this->reached.push_back((VertexId)source);
+        this->open.push_or_decrease(source, 0);
+        for (size_t settled = 0; (this->open.empty() == false) && (settled < limit) && (targets > 0); ++settled) {
+            if (this->open.top_key() > max_cost) {
+                break;
+            }
+            size_t vertex = this->open.pop();
+            if (this->is_target[vertex]) {
+                targets--;
+            }
+            Cost distance = this->distances[vertex];
+            for (auto arc = this->outgoing[vertex].begin(); arc != this->outgoing[vertex].end(); ++arc) {
+                Cost next_distance = distance + arc->cost;
+                if ((arc->vertex == avoided) || (next_distance >= this->distances[arc->vertex])) {
+                    continue;
+                }
+                if (this->distances[arc->vertex] == MAX_COST) {
+                    this->reached.push_back(arc->vertex);
+                }
+                this->distances[arc->vertex] = next_distance;
+                this->open.push_or_decrease(arc->vertex, next_distance);
+            }
+        }
+    }
+
+    // Shortcuts needed to contract the vertex: one per pair of remaining neighbours u -> vertex -> w
+    // without a witness path. Adds them to the graph when `add` is set, then only new arcs are counted.
+    size_t shortcuts(size_t vertex, bool add, size_t limit) {
+        Cost max_outgoing = 0;
+        for (auto arc = this->outgoing[vertex].begin(); arc != this->outgoing[vertex].end(); ++arc) {
+            max_outgoing = std::max(max_outgoing, arc->cost);
+        }
+
+        for (auto arc = this->outgoing[vertex].begin(); arc != this->outgoing[vertex].end(); ++arc) {
+            this->is_target[arc->vertex] = true;
+        }
+
+        size_t count = 0;
+        for (size_t in_index = 0; in_index < this->incoming[vertex].size(); ++in_index) {
+            DynamicArc in_arc = this->incoming[vertex][in_index];
+            // The source may be one of the targets, it is settled first
+            this->witness_search(in_arc.vertex, vertex, in_arc.cost + max_outgoing, limit,
+                                 this->outgoing[vertex].size());
+            for (auto out_arc = this->outgoing[vertex].begin(); out_arc != this->outgoing[vertex].end(); ++out_arc) {
+                Cost shortcut_cost = in_arc.cost + out_arc->cost;
+                if ((out_arc->vertex == in_arc.vertex) || (this->distances[out_arc->vertex] <= shortcut_cost)) {
+                    continue;
+                }
+                if (add == false) {
+                    count++;
+                } else if (set_arc(this->outgoing[in_arc.vertex], out_arc->vertex, shortcut_cost)) {
+                    set_arc(this->incoming[out_arc->vertex], in_arc.vertex, shortcut_cost);
+                    count++;
+                } else {
+                    set_arc(this->incoming[out_arc->vertex], in_arc.vertex, shortcut_cost);
+                }
+            }
+        }
+
+        for (auto arc = this->outgoing[vertex].begin(); arc != this->outgoing[vertex].end(); ++arc) {
+            this->is_target[arc->vertex] = false;
+        }
+        return count;
+    }
+
+public:
+    Contraction(const AdjacencyMatrix &graph, size_t cost_idx)
+        : outgoing(graph.size()+1), incoming(graph.size()+1),
+          contracted_neighbours(graph.size()+1, 0), levels(graph.size()+1, 0), open(graph.size()+1),
+          distances(graph.size()+1, MAX_COST), is_target(graph.size()+1, false) {
+        for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+            const AdjacencyMatrix::Neighbors outgoing_edges = graph[vertex];
+            for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+                if (p_edge->target == vertex) {
+                    continue;
+                }
+                if (set_arc(this->outgoing[vertex], p_edge->target, p_edge->cost[cost_idx])) {
+                    this->arcs++;
+                }
+                set_arc(this->incoming[p_edge->target], vertex, p_edge->cost[cost_idx]);
+            }
+        }
+    }
+
+    // Upper bound on the cost of every shortest path, through the vertex with the most arcs (the hub):
+    // d(u,w) <= d(u,hub) + d(hub,w) when every vertex with outgoing arcs reaches the hub and every vertex with
+    // incoming arcs is reached from it, SIZE_MAX otherwise. Only valid before contracting.
+    size_t shortest_path_cost_bound(void) const {
+        size_t hub = 0;
+        for (size_t vertex = 1; vertex < this->outgoing.size(); ++vertex) {
+            if (this->outgoing[vertex].size() + this->incoming[vertex].size() >
+                this->outgoing[hub].size() + this->incoming[hub].size()) {
+                hub = vertex;
+            }
+        }
+
+        size_t bound = 0;
+        for (size_t direction = 0; direction < 2; ++direction) {
+            // From the hub over the outgoing arcs, then to it over the incoming ones
+            const std::vector<std::vector<DynamicArc>> &arcs = (direction == 0) ? this->outgoing : this->incoming;
+            const std::vector<std::vector<DynamicArc>> &other_arcs = (direction == 0) ? this->incoming : this->outgoing;
+            std::vector<size_t> distances(arcs.size(), SIZE_MAX);
+            typedef std::pair<size_t, size_t> QueueEntry;
+            std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+            distances[hub] = 0;
+            open.push({0, hub});
+            while (open.empty() == false) {
+                QueueEntry entry = open.top();
+                open.pop();
+                if (entry.first != distances[entry.second]) {
+                    continue;
+                }
+                for (auto arc = arcs[entry.second].begin(); arc != arcs[entry.second].end(); ++arc) {
+                    if (entry.first + arc->cost < distances[arc->vertex]) {
+                        distances[arc->vertex] = entry.first + arc->cost;
+                        open.push({entry.first + arc->cost, arc->vertex});
+                    }
+                }
+            }
+
+            size_t farthest = 0;
+            for (size_t vertex = 0; vertex < arcs.size(); ++vertex) {
+                if (other_arcs[vertex].empty()) {
+                    continue;
+                }
+                if (distances[vertex] == SIZE_MAX) {
+                    return SIZE_MAX;
+                }
+                farthest = std::max(farthest, distances[vertex]);
+            }
+            bound = (farthest > SIZE_MAX - bound) ? SIZE_MAX : bound + farthest;
+        }
+        return bound;
+    }
+
+    // Lower is contracted first: the arcs added minus the arcs removed (edge difference), favoured over
+    // terms that spread the contraction evenly over the graph and keep the hierarchy shallow
+    long priority(size_t vertex) {
+        long removed = this->outgoing[vertex].size() + this->incoming[vertex].size();
+        long added = this->shortcuts(vertex, false, ESTIMATE_SETTLE_LIMIT);
+        return 4*(added - removed) + (long)this->contracted_neighbours[vertex] + (long)this->levels[vertex];
+    }
+
+    // Contracts the vertex and returns the number of shortcuts added. `upward` and `downward` receive its
+    // arcs to and from the remaining vertices, which are all more important.
+    size_t contract(size_t vertex, std::vector<DynamicArc> &upward, std::vector<DynamicArc> &downward) {
+        size_t added = this->shortcuts(vertex, true, CONTRACTION_SETTLE_LIMIT);
+        upward.swap(this->outgoing[vertex]);
+        downward.swap(this->incoming[vertex]);
+        this->arcs += added;
+        this->arcs -= upward.size() + downward.size();
+        for (auto arc = upward.begin(); arc != upward.end(); ++arc) {
+            remove_arc(this->incoming[arc->vertex], vertex);
+        }
+        for (auto arc = downward.begin(); arc != downward.end(); ++arc) {
+            remove_arc(this->outgoing[arc->vertex], vertex);
+        }
+        for (size_t direction = 0; direction < 2; ++direction) {
+            const std::vector<DynamicArc> &arcs = (direction == 0) ? upward : downward;
+            for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+                this->contracted_neighbours[arc->vertex]++;
+                this->levels[arc->vertex] = std::max(this->levels[arc->vertex], this->levels[vertex]+1);
+            }
+        }
+        return added;
+    }
+
+    // Moves the arcs of a vertex left in the core to `upward`
+    void take_core_arcs(size_t vertex, std::vector<DynamicArc> &upward) {
+        upward.swap(this->outgoing[vertex]);
+    }
+
+    // Arcs between the remaining vertices
+    size_t arcs_count(void) const { return this->arcs; }
+
+    // One more than the highest level of the contracted neighbours, higher than the level of every
+    // neighbour contracted before
+    size_t level(size_t vertex) const { return this->levels[vertex]; }
+};
+
+} // namespace
+
+
+ContractionHierarchy::ContractionHierarchy(const AdjacencyMatrix &graph, size_t cost_idx)
+    : cost_idx(cost_idx), positions(graph.size()+1), vertices(graph.size()+1), up_offsets(graph.size()+2, 0),
+      down_offsets(graph.size()+2, 0) {
+    size_t vertices_count = graph.size()+1;
+    Contraction contraction(graph, cost_idx);
+    size_t distance_bound = std::min(graph.path_cost_bound()[cost_idx], contraction.shortest_path_cost_bound());
+
+    // Lazy updates: contracting a vertex only marks its neighbours, a marked vertex gets its priority
+    // recomputed when it reaches the top of the queue and is contracted only if it is still the lowest
+    typedef std::pair<long, VertexId> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    for (size_t vertex = 0; vertex < vertices_count; ++vertex) {
+        queue.push({contraction.priority(vertex), (VertexId)vertex});
+    }
+    std::vector<bool> stale(vertices_count, false);
+
+    std::vector<std::vector<DynamicArc>> upward(vertices_count);
+    std::vector<std::vector<DynamicArc>> downward(vertices_count);
+    // Vertices left in the core stay at the top of the sweep order
+    std::vector<size_t> sweep_levels(vertices_count, SIZE_MAX);
+    size_t remaining = vertices_count;
+    while ((queue.empty() == false) && (contraction.arcs_count() <= CORE_AVERAGE_DEGREE * remaining)) {
+        QueueEntry entry = queue.top();
+        queue.pop();
+        if (stale[entry.second]) {
+            stale[entry.second] = false;
+            long priority = contraction.priority(entry.second);
+            if ((queue.empty() == false) && (priority > queue.top().first)) {
+                queue.push({priority, entry.second});
+                continue;
+            }
+        }
+
+        this->shortcuts += contraction.contract(entry.second, upward[entry.second], downward[entry.second]);
+        sweep_levels[entry.second] = contraction.level(entry.second);
+        remaining--;
+        for (size_t direction = 0; direction < 2; ++direction) {
+            const std::vector<DynamicArc> &arcs = (direction == 0) ? upward[entry.second] : downward[entry.second];
+            for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+                stale[arc->vertex] = true;
+            }
+        }
+    }
+
+    while (queue.empty() == false) {
+        contraction.take_core_arcs(queue.top().second, upward[queue.top().second]);
+        queue.pop();
+    }
+
+    // Levels only grow towards more important vertices, so decreasing level is a valid sweep order. Within
+    // a level vertices keep their order, so the sweep walks locality ordered graphs mostly in sequence.
+    for (size_t vertex = 0; vertex < vertices_count; ++vertex) {
+        this->vertices[vertex] = (VertexId)vertex;
+    }
+    std::stable_sort(this->vertices.begin(), this->vertices.end(), [&sweep_levels](VertexId vertex1, VertexId vertex2) {
+        return sweep_levels[vertex1] > sweep_levels[vertex2];
+    });
+    for (size_t position = 0; position < vertices_count; ++position) {
+        this->positions[this->vertices[position]] = (VertexId)position;
+    }
+    for (size_t position = 0; position < vertices_count; ++position) {
+        size_t vertex = this->vertices[position];
+        this->up_offsets[position+1] = this->up_offsets[position] + upward[vertex].size();
+        this->down_offsets[position+1] = this->down_offsets[position] + downward[vertex].size();
+    }
+    this->up_arcs.resize(this->up_offsets[vertices_count]);
+    this->down_arcs.resize(this->down_offsets[vertices_count]);
+    for (size_t position = 0; position < vertices_count; ++position) {
+        size_t vertex = this->vertices[position];
+        Arc *up = &this->up_arcs[this->up_offsets[position]];
+        for (auto arc = upward[vertex].begin(); arc != upward[vertex].end(); ++arc) {
+            *up++ = {this->positions[arc->vertex], arc->cost};
+        }
+        // The sweep reads the tails in increasing position, close to where it already is
+        Arc *down = &this->down_arcs[this->down_offsets[position]];
+        for (auto arc = downward[vertex].begin(); arc != downward[vertex].end(); ++arc) {
+            *down++ = {this->positions[arc->vertex], arc->cost};
+            this->max_down_cost = std::max(this->max_down_cost, arc->cost);
+        }
+        std::sort(&this->down_arcs[this->down_offsets[position]], down,
+                  [](const Arc &arc1, const Arc &arc2) { return arc1.position < arc2.position; });
+        upward[vertex] = std::vector<DynamicArc>();
+        downward[vertex] = std::vector<DynamicArc>();
+    }
+
+    // The batched sweep needs every distance below its marker of unreached vertices, see many_to_all()
+    this->batch_sweeps = distance_bound < (size_t)(MAX_COST - this->max_down_cost);
+}
+
+
+// Dijkstra over the upward arcs, it only ever reaches more important vertices and stays small. Writes the
+// distances to sweep[position*stride], entries are (distance, position) and stale ones are skipped when popped.
+void ContractionHierarchy::upward_search(size_t source, Cost *sweep, size_t stride) const {
+    typedef std::pair<Cost, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    sweep[this->positions[source]*stride] = 0;
+    open.push({0, this->positions[source]});
+    while (open.empty() == false) {
+        QueueEntry entry = open.top();
+        open.pop();
+        if (entry.first != sweep[entry.second*stride]) {
+            continue;
+        }
+        for (size_t index = this->up_offsets[entry.second]; index < this->up_offsets[entry.second+1]; ++index) {
+            const Arc &arc = this->up_arcs[index];
+            if (entry.first + arc.cost < sweep[arc.position*stride]) {
+                sweep[arc.position*stride] = entry.first + arc.cost;
+                open.push({entry.first + arc.cost, arc.position});
+            }
+        }
+    }
+}
+
+
+void ContractionHierarchy::one_to_all(size_t source, Pair<Cost> *distances) const {
+    size_t vertices_count = this->vertices.size();
+    HugePageVector<Cost> sweep(vertices_count, MAX_COST);
+    this->upward_search(source, sweep.data(), 1);
+
+    // Downward sweep, every tail is more important than its head and so already final
+    for (size_t position = 0; position < vertices_count; ++position) {
+        Cost distance = sweep[position];
+        for (size_t index = this->down_offsets[position]; index < this->down_offsets[position+1]; ++index) {
+            const Arc &arc = this->down_arcs[index];
+            if ((sweep[arc.position] != MAX_COST) && (sweep[arc.position] + arc.cost < distance)) {
+                distance = sweep[arc.position] + arc.cost;
+            }
+        }
+        sweep[position] = distance;
+    }
+
+    for (size_t position = 0; position < vertices_count; ++position) {
+        distances[this->vertices[position]][this->cost_idx] = sweep[position];
+    }
+}
+
+
+void ContractionHierarchy::many_to_all(const std::vector<size_t> &sources, Cost *distances) const {
+    if (sources.size() > BATCH_SIZE) {
+        throw std::invalid_argument("More sources than ContractionHierarchy::BATCH_SIZE");
+    }
+    if (this->batch_sweeps == false) {
+        std::vector<Pair<Cost>> source_distances(this->vertices.size());
+        for (size_t lane = 0; lane < BATCH_SIZE; ++lane) {
+            if (lane < sources.size()) {
+                this->one_to_all(sources[lane], source_distances.data());
+            }
+            for (size_t vertex = 0; vertex < this->vertices.size(); ++vertex) {
+                distances[vertex*BATCH_SIZE + lane] =
+                    (lane < sources.size()) ? source_distances[vertex][this->cost_idx] : MAX_COST;
+            }
+        }
+        return;
+    }
+
+    // Vertices not reached yet hold a value no arc can push past MAX_COST, so the sweep needs no overflow
+    // test, which would keep the compiler from vectorizing it. Sums from it stay at least as high.
+    Cost unreached = MAX_COST - this->max_down_cost;
+    size_t vertices_count = this->vertices.size();
+    HugePageVector<Cost> sweep(vertices_count*BATCH_SIZE, unreached);
+    for (size_t lane = 0; lane < sources.size(); ++lane) {
+        this->upward_search(sources[lane], sweep.data() + lane, BATCH_SIZE);
+    }
+
+    // The lanes of a vertex are worked on in a local copy, so the compiler knows they do not overlap the tail's
+    Cost lanes[BATCH_SIZE];
+    for (size_t position = 0; position < vertices_count; ++position) {
+        Cost *entries = sweep.data() + position*BATCH_SIZE;
+        std::copy(entries, entries + BATCH_SIZE, lanes);
+        for (size_t index = this->down_offsets[position]; index < this->down_offsets[position+1]; ++index) {
+            const Arc &arc = this->down_arcs[index];
+            const Cost *tail = sweep.data() + arc.position*BATCH_SIZE;
+            for (size_t lane = 0; lane < BATCH_SIZE; ++lane) {
+                lanes[lane] = std::min(lanes[lane], tail[lane] + arc.cost);
+            }
+        }
+        std::copy(lanes, lanes + BATCH_SIZE, entries);
+    }
+
+    for (size_t position = 0; position < vertices_count; ++position) {
+        const Cost *entries = sweep.data() + position*BATCH_SIZE;
+        Cost *vertex_distances = distances + this->vertices[position]*BATCH_SIZE;
+        for (size_t lane = 0; lane < BATCH_SIZE; ++lane) {
+            vertex_distances[lane] = (entries[lane] >= unreached) ? MAX_COST : entries[lane];
+        }
+    }
+}
+
+
+size_t ContractionHierarchy::size() const {return this->vertices.empty() ? 0 : this->vertices.size()-1;}
+
+
+size_t ContractionHierarchy::criterion() const {return this->cost_idx;}
+
+
+size_t ContractionHierarchy::shortcuts_count() const {return this->shortcuts;}
+
+
+size_t ContractionHierarchy::memory_usage() const {
+    return (this->positions.size() + this->vertices.size()) * sizeof(VertexId) +
+           (this->up_offsets.size() + this->down_offsets.size()) * sizeof(size_t) +
+           (this->up_arcs.size() + this->down_arcs.size()) * sizeof(Arc);
+}
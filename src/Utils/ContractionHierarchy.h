@@ -0,0 +1,65 @@
+#ifndef UTILS_CONTRACTION_HIERARCHY_H
+#define UTILS_CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include "Definitions.h"
+#include "HugePages.h"
+
+// Contraction hierarchy of one criterion of a graph (Geisberger et al.) for one-to-all searches with
+// PHAST (Delling et al.). Vertices are contracted one at a time, least important first, adding
+// shortcut arcs between their remaining neighbours where no witness path is as cheap. Every shortest
+// path then has a shortest up-down counterpart: arcs to more important vertices, then arcs to less
+// important ones. A one-to-all search is a small upward Dijkstra from the source followed by one linear
+// sweep over the downward arcs of all vertices, in decreasing importance, with no priority queue.
+// Contraction stops early where the rest of the graph is dense, that core is covered by the upward search.
+//
+// The hierarchy holds the costs of the graph when it was built, it is not updated by update_costs().
+class ContractionHierarchy {
+public:
+    // Sources of one many_to_all() sweep. With 32 bit costs the entries of a vertex fill one cache line.
+    static const size_t BATCH_SIZE = 16;
+
+private:
+    struct Arc {
+        VertexId    position;   // Of the other end, see positions
+        Cost        cost;
+    };
+
+    size_t                      cost_idx = 0;
+    size_t                      shortcuts = 0;
+    Cost                        max_down_cost = 0;
+    bool                        batch_sweeps = true;    // Whether many_to_all() can sweep its sources together
+    // Vertices are stored by decreasing importance, the order of the sweep: positions[v] is the place of
+    // vertex v and vertices[p] the vertex at place p
+    HugePageVector<VertexId>    positions;
+    HugePageVector<VertexId>    vertices;
+    // Arcs to more important vertices per position, and arcs from more important vertices stored at their head
+    HugePageVector<size_t>      up_offsets;
+    HugePageVector<Arc>         up_arcs;
+    HugePageVector<size_t>      down_offsets;
+    HugePageVector<Arc>         down_arcs;
+
+    void upward_search(size_t source, Cost *sweep, size_t stride) const;
+
+public:
+    ContractionHierarchy() = default;
+    ContractionHierarchy(const AdjacencyMatrix &graph, size_t cost_idx);
+
+    // Writes the cost of the shortest path from `source` to every vertex to distances[v][cost_idx]
+    // (MAX_COST if unreachable), graph.size()+1 entries. The same values as a Dijkstra on the graph.
+    void one_to_all(size_t source, Pair<Cost> *distances) const;
+    // The same from up to BATCH_SIZE sources at once, into one interleaved table: distances[v*BATCH_SIZE + i]
+    // is the cost from sources[i] to v, (graph.size()+1)*BATCH_SIZE entries. The sweep relaxes every arc for all
+    // the sources together, in loops the compiler turns into vector instructions (from SSE2 on with 32 bit costs,
+    // AVX-512 with 64 bit ones). Unused lanes are MAX_COST. Throws std::invalid_argument for more sources.
+    // The sweep marks unreached vertices with MAX_COST minus the costliest downward arc, so graphs whose path
+    // costs could reach that marker (checked when building) are swept one source at a time instead.
+    void many_to_all(const std::vector<size_t> &sources, Cost *distances) const;
+
+    size_t size(void) const;
+    size_t criterion(void) const;
+    size_t shortcuts_count(void) const;
+    size_t memory_usage(void) const;
+};
+
+#endif //UTILS_CONTRACTION_HIERARCHY_H
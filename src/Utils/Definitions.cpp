@@ -1,44 +1,615 @@
 #include <iostream>
 #include <set>
 #include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <queue>
 #include "Definitions.h"
+#include "HugePages.h"
 
-AdjacencyMatrix::AdjacencyMatrix(size_t graph_size, std::vector<Edge> &edges, bool inverse)
-    : matrix((graph_size+1), std::vector<Edge>()), graph_size(graph_size) {
+const size_t    WeightedSumTableView::WEIGHTS_COUNT;
+const uint64_t  WeightedSumTableView::MAX_CHECKED_BOUND;
+const uint64_t  WeightedSumTableView::UNREACHABLE_SUM;
 
+// Heap storage of the CSR columns of a graph built from an edge list
+struct CSRArrays {
+    HugePageVector<size_t>      offsets;
+    HugePageVector<VertexId>    targets;
+    Pair<HugePageVector<Cost>>  costs;
+};
+
+
+AdjacencyMatrix::AdjacencyMatrix(size_t graph_size, std::vector<Edge> &edges, bool inverse) {
+    AdjacencyMatrixBuilder builder(graph_size);
+    for (auto iter = edges.begin(); iter != edges.end(); ++iter) {
+        builder.count_edge(inverse ? iter->target : iter->source);
+    }
+
+    builder.allocate(graph_size);
     for (auto iter = edges.begin(); iter != edges.end(); ++iter) {
         if (inverse) {
-            this->add(iter->inverse());
+            builder.add_edge(iter->target, iter->source, iter->cost);
         } else {
-            this->add((*iter));
+            builder.add_edge(iter->source, iter->target, iter->cost);
         }
     }
+
+    *this = builder.build();
+}
+
+
+AdjacencyMatrix::AdjacencyMatrix(size_t graph_size, size_t edges_count, const size_t *offsets, const VertexId *targets,
+                                 Pair<const Cost *> costs, std::shared_ptr<const void> storage)
+    : graph_size(graph_size), edges_amount(edges_count), stored_edges(edges_count), offsets(offsets),
+      end_offsets(offsets+1), targets(targets), costs(costs), storage(storage) {}
+
+
+AdjacencyMatrixBuilder::AdjacencyMatrixBuilder(size_t graph_size_hint)
+    : arrays(std::make_shared<CSRArrays>()) {
+    this->arrays->offsets.reserve(graph_size_hint+2);
+}
+
+
+void AdjacencyMatrixBuilder::reserve(size_t graph_size) {
+    if (graph_size+2 > this->arrays->offsets.size()) {
+        this->arrays->offsets.resize(graph_size+2, 0);
+    }
+}
+
+
+void AdjacencyMatrixBuilder::count_edge(size_t source) {
+    this->count_edges(source, 1);
+}
+
+
+void AdjacencyMatrixBuilder::count_edges(size_t source, size_t count) {
+    // Degrees are counted shifted by one, so the prefix sum in allocate() yields the offsets
+    this->reserve(source);
+    this->arrays->offsets[source+1] += count;
+}
+
+
+void AdjacencyMatrixBuilder::allocate(size_t graph_size) {
+    HugePageVector<size_t> &offsets = this->arrays->offsets;
+    this->graph_size = graph_size;
+    offsets.resize(graph_size+2, 0);
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i-1];
+    }
+
+    this->edges_amount = offsets.back();
+    this->arrays->targets.resize(this->edges_amount);
+    this->arrays->costs[0].resize(this->edges_amount);
+    this->arrays->costs[1].resize(this->edges_amount);
+}
+
+
+void AdjacencyMatrixBuilder::add_edge(size_t source, size_t target, Pair<Cost> cost) {
+    // offsets[source] is used as the insertion cursor of source until build() restores it
+    this->place_edge(this->arrays->offsets[source]++, target, cost);
+}
+
+
+AdjacencyMatrix AdjacencyMatrixBuilder::build(void) {
+    // After the scatter every cursor points at the start of the next vertex, shift them back
+    HugePageVector<size_t> &offsets = this->arrays->offsets;
+    for (size_t i = offsets.size()-1; i > 0; --i) {
+        offsets[i] = offsets[i-1];
+    }
+    offsets[0] = 0;
+    return this->take_graph();
+}
+
+
+size_t AdjacencyMatrixBuilder::edges_begin(size_t source) const {
+    return this->arrays->offsets[source];
 }
 
 
-void AdjacencyMatrix::add(Edge edge) {
-    (this->matrix[edge.source]).push_back(edge);
+void AdjacencyMatrixBuilder::place_edge(size_t slot, size_t target, Pair<Cost> cost) {
+    this->arrays->targets[slot] = target;
+    this->arrays->costs[0][slot] = cost[0];
+    this->arrays->costs[1][slot] = cost[1];
+}
+
+
+AdjacencyMatrix AdjacencyMatrixBuilder::build_placed(void) {
+    return this->take_graph();
+}
+
+
+AdjacencyMatrix AdjacencyMatrixBuilder::take_graph(void) {
+    std::shared_ptr<CSRArrays> arrays = this->arrays;
+    this->arrays = std::make_shared<CSRArrays>();
+    return AdjacencyMatrix(this->graph_size, this->edges_amount, arrays->offsets.data(), arrays->targets.data(),
+                           {{arrays->costs[0].data(), arrays->costs[1].data()}}, arrays);
 }
 
 
 size_t AdjacencyMatrix::size() const {return this->graph_size;}
 
 
-const std::vector<Edge>& AdjacencyMatrix::operator[](size_t vertex_id) const {
-    return this->matrix.at(vertex_id);
+size_t AdjacencyMatrix::edges_count() const {return this->edges_amount;}
+
+
+Pair<size_t> AdjacencyMatrix::path_cost_bound() const {
+    Pair<size_t> bound = {0, 0};
+    for (size_t vertex = 0; vertex <= this->graph_size; ++vertex) {
+        Pair<Cost> max_edge_cost = {0, 0};
+        Neighbors edges = (*this)[vertex];
+        for (auto p_edge = edges.begin(); p_edge != edges.end(); ++p_edge) {
+            max_edge_cost[0] = std::max(max_edge_cost[0], p_edge->cost[0]);
+            max_edge_cost[1] = std::max(max_edge_cost[1], p_edge->cost[1]);
+        }
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            bound[cost_idx] = (bound[cost_idx] > SIZE_MAX - max_edge_cost[cost_idx]) ?
+                                SIZE_MAX : bound[cost_idx] + max_edge_cost[cost_idx];
+        }
+    }
+    return bound;
 }
 
 
-std::ostream& operator<<(std::ostream &stream, const AdjacencyMatrix &adj_matrix) {
-    size_t  i = 0;
+// Heap storage of a compressed graph
+struct CompressedArrays {
+    HugePageVector<size_t>  offsets;
+    HugePageVector<size_t>  byte_offsets;
+    HugePageVector<uint8_t> bytes;
+};
+
+
+void write_varint(HugePageVector<uint8_t> &bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((uint8_t)value);
+}
+
+
+uint64_t read_varint(const uint8_t *&cursor) {
+    uint64_t value = *cursor++;
+    if (value < 0x80) {
+        return value;
+    }
+    value &= 0x7f;
+    unsigned shift = 7;
+    uint8_t byte;
+    do {
+        byte = *cursor++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
 
+void AdjacencyMatrix::Neighbors::decode(const AdjacencyMatrix *graph, size_t vertex_id) {
+    this->last -= this->first;
+    this->first = 0;
+    this->decoded = true;
+    if (this->last > INLINE_EDGES) {
+        this->heap_edges.reset(new DecodedEdges());
+        this->heap_edges->targets.resize(this->last);
+        this->heap_edges->costs[0].resize(this->last);
+        this->heap_edges->costs[1].resize(this->last);
+    }
+    VertexId *targets = this->decoded_targets();
+    Pair<Cost *> costs = {{this->decoded_costs(0), this->decoded_costs(1)}};
+    const uint8_t *cursor = graph->bytes + graph->byte_offsets[vertex_id];
+    int64_t target = (int64_t)vertex_id;
+    for (size_t edge = 0; edge < this->last; ++edge) {
+        uint64_t delta = read_varint(cursor);
+        target += (int64_t)(delta >> 1) ^ -(int64_t)(delta & 1);
+        targets[edge] = (VertexId)target;
+        costs[0][edge] = (Cost)read_varint(cursor);
+        costs[1][edge] = (Cost)read_varint(cursor);
+    }
+    this->use_decoded();
+}
+
+
+AdjacencyMatrix AdjacencyMatrix::compress() const {
+    std::shared_ptr<CompressedArrays> arrays = std::make_shared<CompressedArrays>();
+    arrays->offsets.reserve(this->graph_size + 2);
+    arrays->byte_offsets.reserve(this->graph_size + 2);
+
+    std::vector<EdgeView> edges;
+    size_t edges_amount = 0;
+    for (size_t vertex = 0; vertex <= this->graph_size; ++vertex) {
+        arrays->offsets.push_back(edges_amount);
+        arrays->byte_offsets.push_back(arrays->bytes.size());
+
+        // Sorting the targets keeps the deltas (and so their encodings) small
+        Neighbors neighbors = (*this)[vertex];
+        edges.assign(neighbors.begin(), neighbors.end());
+        std::stable_sort(edges.begin(), edges.end(),
+                         [](const EdgeView &a, const EdgeView &b) {return a.target < b.target;});
+
+        int64_t previous_target = (int64_t)vertex;
+        for (auto edge = edges.begin(); edge != edges.end(); ++edge) {
+            int64_t delta = (int64_t)edge->target - previous_target;
+            write_varint(arrays->bytes, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+            write_varint(arrays->bytes, edge->cost[0]);
+            write_varint(arrays->bytes, edge->cost[1]);
+            previous_target = edge->target;
+        }
+        edges_amount += edges.size();
+    }
+    arrays->offsets.push_back(edges_amount);
+    arrays->byte_offsets.push_back(arrays->bytes.size());
+    arrays->bytes.shrink_to_fit();
+
+    AdjacencyMatrix compressed;
+    compressed.graph_size = this->graph_size;
+    compressed.edges_amount = this->edges_amount;
+    compressed.stored_edges = this->edges_amount;
+    compressed.offsets = arrays->offsets.data();
+    compressed.end_offsets = compressed.offsets + 1;
+    compressed.byte_offsets = arrays->byte_offsets.data();
+    compressed.bytes = arrays->bytes.data();
+    compressed.storage = arrays;
+    return compressed;
+}
+
+
+bool AdjacencyMatrix::is_compressed() const {return this->bytes != nullptr;}
+
+
+bool AdjacencyMatrix::is_contiguous() const {return this->end_offsets == this->offsets + 1;}
+
+
+size_t AdjacencyMatrix::memory_usage() const {
+    if (this->is_compressed()) {
+        return 2 * (this->graph_size + 2) * sizeof(size_t) + this->byte_offsets[this->graph_size+1];
+    }
+    // Shared graphs keep three offset arrays (vertex start, symmetric arcs start and end)
+    size_t offset_arrays = this->is_contiguous() ? 1 : 3;
+    return offset_arrays * (this->graph_size + 2) * sizeof(size_t) +
+           this->stored_edges * (sizeof(VertexId) + 2*sizeof(Cost));
+}
+
+
+bool AdjacencyMatrix::shares_storage_with(const AdjacencyMatrix &other) const {
+    return (this->storage != nullptr) && (this->storage == other.storage);
+}
+
+
+void AdjacencyMatrix::make_private_copy() {
+    std::shared_ptr<CSRArrays> arrays = std::make_shared<CSRArrays>();
+    arrays->offsets.reserve(this->graph_size + 2);
+    arrays->targets.reserve(this->edges_amount);
+    arrays->costs[0].reserve(this->edges_amount);
+    arrays->costs[1].reserve(this->edges_amount);
+
+    arrays->offsets.push_back(0);
+    for (size_t vertex = 0; vertex <= this->graph_size; ++vertex) {
+        Neighbors edges = (*this)[vertex];
+        for (auto p_edge = edges.begin(); p_edge != edges.end(); ++p_edge) {
+            arrays->targets.push_back(p_edge->target);
+            arrays->costs[0].push_back(p_edge->cost[0]);
+            arrays->costs[1].push_back(p_edge->cost[1]);
+        }
+        arrays->offsets.push_back(arrays->targets.size());
+    }
+
+    *this = AdjacencyMatrix(this->graph_size, this->edges_amount, arrays->offsets.data(), arrays->targets.data(),
+                            {{arrays->costs[0].data(), arrays->costs[1].data()}}, arrays);
+    this->writable_costs = {{arrays->costs[0].data(), arrays->costs[1].data()}};
+}
+
+
+std::vector<CostUpdate> AdjacencyMatrix::update_costs(const std::vector<Edge> &updates) {
+    if ((this->writable_costs[0] == nullptr) || (this->storage.use_count() > 1)) {
+        this->make_private_copy();
+    }
+
+    // An arc updated several times in the batch yields a single change, from its original to its last costs
+    std::vector<CostUpdate> changes;
+    std::unordered_map<size_t, size_t> slot_changes;
+    for (auto update = updates.begin(); update != updates.end(); ++update) {
+        if (update->source > this->graph_size) {
+            continue;
+        }
+        for (size_t slot = this->offsets[update->source]; slot < this->end_offsets[update->source]; ++slot) {
+            if (this->targets[slot] != update->target) {
+                continue;
+            }
+            auto p_change = slot_changes.find(slot);
+            if (p_change != slot_changes.end()) {
+                changes[p_change->second].new_cost = update->cost;
+            } else {
+                slot_changes[slot] = changes.size();
+                changes.push_back({update->source, update->target, {{this->costs[0][slot], this->costs[1][slot]}}, update->cost});
+            }
+            this->writable_costs[0][slot] = update->cost[0];
+            this->writable_costs[1][slot] = update->cost[1];
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < changes.size(); ++i) {
+        if (changes[i].old_cost != changes[i].new_cost) {
+            changes[kept++] = changes[i];
+        }
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            if (changes[i].new_cost[cost_idx] > changes[i].old_cost[cost_idx]) {
+                this->cost_headroom[cost_idx] = 0;
+            }
+        }
+    }
+    changes.resize(kept);
+    return changes;
+}
+
+
+Pair<size_t> AdjacencyMatrix::path_cost_headroom() const {return this->cost_headroom;}
+
+
+void AdjacencyMatrix::set_path_cost_headroom(Pair<size_t> headroom) {this->cost_headroom = headroom;}
+
+
+// Costliest shortest path cost from `source` over cost_idx, summed in size_t so it can not overflow. A path that
+// is not covered through the source lies among the vertices the search does not reach (a vertex on it reached
+// from the source would connect its ends to the source), so it costs at most the sum of their costliest arcs in
+// `other_graph`, the reverse of `graph`. Returns the larger of the two.
+size_t max_shortest_path_cost(const AdjacencyMatrix &graph, const AdjacencyMatrix &other_graph, size_t source,
+                              size_t cost_idx) {
+    std::vector<size_t> distances(graph.size()+1, SIZE_MAX);
+    typedef std::pair<size_t, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    distances[source] = 0;
+    open.push({0, source});
+
+    size_t max_distance = 0;
+    while (open.empty() == false) {
+        QueueEntry entry = open.top();
+        open.pop();
+        if (entry.first != distances[entry.second]) {
+            continue;
+        }
+
+        max_distance = entry.first;
+        const AdjacencyMatrix::Neighbors outgoing_edges = graph[entry.second];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); p_edge++) {
+            size_t next_distance = entry.first + p_edge->cost[cost_idx];
+            if (next_distance < distances[p_edge->target]) {
+                distances[p_edge->target] = next_distance;
+                open.push({next_distance, p_edge->target});
+            }
+        }
+    }
+
+    size_t unreached_bound = 0;
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        if (distances[vertex] != SIZE_MAX) {
+            continue;
+        }
+        size_t costliest = 0;
+        const AdjacencyMatrix::Neighbors other_edges = other_graph[vertex];
+        for (auto p_edge = other_edges.begin(); p_edge != other_edges.end(); p_edge++) {
+            costliest = std::max<size_t>(costliest, p_edge->cost[cost_idx]);
+        }
+        unreached_bound = (costliest > SIZE_MAX - unreached_bound) ? SIZE_MAX : unreached_bound + costliest;
+    }
+    return std::max(max_distance, unreached_bound);
+}
+
+
+bool path_costs_fit(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph) {
+    Pair<size_t> headroom;
+    return path_costs_fit(graph, inv_graph, headroom);
+}
+
+
+bool path_costs_fit(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph, Pair<size_t> &headroom) {
+    Pair<size_t> path_cost_bound = graph.path_cost_bound();
+    if ((path_cost_bound[0] < MAX_COST) && (path_cost_bound[1] < MAX_COST)) {
+        headroom = {{MAX_COST-1 - path_cost_bound[0], MAX_COST-1 - path_cost_bound[1]}};
+        return true;
+    }
+
+    // A search adds one arc to the cost of a path before comparing it, so an arc must fit the same room
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        const AdjacencyMatrix::Neighbors edges = graph[vertex];
+        for (auto p_edge = edges.begin(); p_edge != edges.end(); p_edge++) {
+            if ((p_edge->cost[0] >= MAX_COST/2) || (p_edge->cost[1] >= MAX_COST/2)) {
+                return false;
+            }
+        }
+    }
+
+    // The vertex with the most arcs, likely inside the largest strongly connected part
+    size_t source = 0;
+    for (size_t vertex = 1; vertex <= graph.size(); ++vertex) {
+        if (graph[vertex].size() + inv_graph[vertex].size() > graph[source].size() + inv_graph[source].size()) {
+            source = vertex;
+        }
+    }
+    for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+        // Paths from vertices with outgoing arcs to vertices with incoming arcs, all through the source
+        size_t to_source = max_shortest_path_cost(inv_graph, graph, source, cost_idx);
+        size_t from_source = max_shortest_path_cost(graph, inv_graph, source, cost_idx);
+        if ((to_source >= MAX_COST/2) || (from_source >= MAX_COST/2 - to_source)) {
+            return false;
+        }
+        // Both grow with the arc costs, their sum must stay below half of MAX_COST
+        headroom[cost_idx] = (MAX_COST/2 - 1 - to_source - from_source) / 2;
+    }
+    return true;
+}
+
+
+bool update_edge_costs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph, const std::vector<Edge> &updates,
+                       std::vector<CostUpdate> &changes) {
+    Pair<size_t> headroom = graph.path_cost_headroom();
+    changes = graph.update_costs(updates);
+
+    // Only costs that grew can break the guarantee of the loaders
+    Pair<size_t> growth = {{0, 0}};
+    bool arcs_fit = true;
+    std::vector<Edge> inv_updates;
+    inv_updates.reserve(changes.size());
+    for (auto change = changes.begin(); change != changes.end(); ++change) {
+        inv_updates.push_back(Edge(change->target, change->source, change->new_cost));
+        for (size_t cost_idx = 0; cost_idx < 2; ++cost_idx) {
+            if (change->new_cost[cost_idx] > change->old_cost[cost_idx]) {
+                size_t arc_growth = change->new_cost[cost_idx] - change->old_cost[cost_idx];
+                growth[cost_idx] = (arc_growth > SIZE_MAX - growth[cost_idx]) ? SIZE_MAX : growth[cost_idx] + arc_growth;
+                arcs_fit &= (change->new_cost[cost_idx] < MAX_COST/2);
+            }
+        }
+    }
+    inv_graph.update_costs(inv_updates);
+
+    // Within the headroom of the last check only the changed arcs are checked, see path_costs_fit
+    if (arcs_fit && (growth[0] <= headroom[0]) && (growth[1] <= headroom[1])) {
+        graph.set_path_cost_headroom({{headroom[0] - growth[0], headroom[1] - growth[1]}});
+        return true;
+    }
+
+    Pair<size_t> new_headroom;
+    if (path_costs_fit(graph, inv_graph, new_headroom) == false) {
+        std::vector<Edge> restore;
+        std::vector<Edge> inv_restore;
+        for (auto change = changes.begin(); change != changes.end(); ++change) {
+            restore.push_back(Edge(change->source, change->target, change->old_cost));
+            inv_restore.push_back(Edge(change->target, change->source, change->old_cost));
+        }
+        graph.update_costs(restore);
+        inv_graph.update_costs(inv_restore);
+        graph.set_path_cost_headroom(headroom);
+        changes.clear();
+        return false;
+    }
+    graph.set_path_cost_headroom(new_headroom);
+    return true;
+}
+
+
+// Heap storage of a forward and reverse graph pair sharing their symmetric arcs.
+// The edges of vertex v are laid out as [reverse only | symmetric | forward only] starting at
+// vertex_offsets[v], with the symmetric arcs spanning [symmetric_offsets[v], symmetric_ends[v]).
+struct SharedArrays {
+    HugePageVector<size_t>      vertex_offsets;
+    HugePageVector<size_t>      symmetric_offsets;
+    HugePageVector<size_t>      symmetric_ends;
+    HugePageVector<VertexId>    targets;
+    Pair<HugePageVector<Cost>>  costs;
+
+    void push_edge(const AdjacencyMatrix::EdgeView &edge) {
+        this->targets.push_back(edge.target);
+        this->costs[0].push_back(edge.cost[0]);
+        this->costs[1].push_back(edge.cost[1]);
+    }
+};
+
+
+double share_symmetric_arcs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph) {
+    if (graph.size() != inv_graph.size()) {
+        throw std::invalid_argument("Only a graph and its reverse can share their arcs");
+    }
+    if (graph.is_compressed() || inv_graph.is_compressed()) {
+        throw std::invalid_argument("Compressed graphs can not share their arcs");
+    }
+
+    typedef AdjacencyMatrix::EdgeView EdgeView;
+    auto edge_order = [](const EdgeView &a, const EdgeView &b) {
+        if (a.target != b.target) {
+            return a.target < b.target;
+        }
+        return (a.cost[0] != b.cost[0]) ? (a.cost[0] < b.cost[0]) : (a.cost[1] < b.cost[1]);
+    };
+    auto same_edge = [](const EdgeView &a, const EdgeView &b) {
+        return (a.target == b.target) && (a.cost[0] == b.cost[0]) && (a.cost[1] == b.cost[1]);
+    };
+
+    size_t graph_size = graph.size();
+    std::shared_ptr<SharedArrays> arrays = std::make_shared<SharedArrays>();
+    arrays->vertex_offsets.reserve(graph_size + 2);
+    arrays->symmetric_offsets.reserve(graph_size + 2);
+    arrays->symmetric_ends.reserve(graph_size + 2);
+    // Symmetric arcs are stored once, so this is an upper bound
+    size_t edges_bound = graph.edges_count() + inv_graph.edges_count();
+    arrays->targets.reserve(edges_bound);
+    arrays->costs[0].reserve(edges_bound);
+    arrays->costs[1].reserve(edges_bound);
+
+    std::vector<EdgeView> forward, reverse, symmetric, forward_only;
+    for (size_t vertex = 0; vertex <= graph_size; ++vertex) {
+        AdjacencyMatrix::Neighbors out_edges = graph[vertex];
+        AdjacencyMatrix::Neighbors in_edges = inv_graph[vertex];
+        forward.assign(out_edges.begin(), out_edges.end());
+        reverse.assign(in_edges.begin(), in_edges.end());
+        std::sort(forward.begin(), forward.end(), edge_order);
+        std::sort(reverse.begin(), reverse.end(), edge_order);
+
+        // Merge the sorted lists: an arc vertex->u matches an arc u->vertex with the same costs.
+        // Parallel arcs are matched one to one.
+        arrays->vertex_offsets.push_back(arrays->targets.size());
+        symmetric.clear();
+        forward_only.clear();
+        auto p_forward = forward.begin();
+        auto p_reverse = reverse.begin();
+        while ((p_forward != forward.end()) || (p_reverse != reverse.end())) {
+            if ((p_reverse == reverse.end()) ||
+                ((p_forward != forward.end()) && edge_order(*p_forward, *p_reverse))) {
+                forward_only.push_back(*p_forward++);
+            } else if ((p_forward == forward.end()) || !same_edge(*p_forward, *p_reverse)) {
+                arrays->push_edge(*p_reverse++);
+            } else {
+                symmetric.push_back(*p_forward++);
+                ++p_reverse;
+            }
+        }
+
+        arrays->symmetric_offsets.push_back(arrays->targets.size());
+        for (auto edge = symmetric.begin(); edge != symmetric.end(); ++edge) {
+            arrays->push_edge(*edge);
+        }
+        arrays->symmetric_ends.push_back(arrays->targets.size());
+        for (auto edge = forward_only.begin(); edge != forward_only.end(); ++edge) {
+            arrays->push_edge(*edge);
+        }
+    }
+    arrays->vertex_offsets.push_back(arrays->targets.size());
+    arrays->symmetric_offsets.push_back(arrays->targets.size());
+    arrays->symmetric_ends.push_back(arrays->targets.size());
+    arrays->targets.shrink_to_fit();
+    arrays->costs[0].shrink_to_fit();
+    arrays->costs[1].shrink_to_fit();
+
+    size_t stored_edges = arrays->targets.size();
+    size_t symmetric_edges = graph.edges_count() + inv_graph.edges_count() - stored_edges;
+    double symmetric_fraction = graph.edges_count() == 0 ? 0 : (double)symmetric_edges / graph.edges_count();
+
+    // Forward edges of v: [symmetric_offsets[v], vertex_offsets[v+1])
+    // Reverse edges of v: [vertex_offsets[v], symmetric_ends[v])
+    Pair<const Cost *> costs = {{arrays->costs[0].data(), arrays->costs[1].data()}};
+    graph.offsets = arrays->symmetric_offsets.data();
+    graph.end_offsets = arrays->vertex_offsets.data() + 1;
+    inv_graph.offsets = arrays->vertex_offsets.data();
+    inv_graph.end_offsets = arrays->symmetric_ends.data();
+    for (AdjacencyMatrix *shared : {&graph, &inv_graph}) {
+        shared->stored_edges = stored_edges;
+        shared->targets = arrays->targets.data();
+        shared->costs = costs;
+        shared->storage = arrays;
+        shared->writable_costs = {{nullptr, nullptr}};
+    }
+    return symmetric_fraction;
+}
+
+
+std::ostream& operator<<(std::ostream &stream, const AdjacencyMatrix &adj_matrix) {
     stream << "{\n";
-    for (auto vertex_iter = adj_matrix.matrix.begin(); vertex_iter != adj_matrix.matrix.end(); ++vertex_iter) {
-        stream << "\t\"" << i++ << "\": [";
+    for (size_t i = 0; i <= adj_matrix.graph_size; ++i) {
+        stream << "\t\"" << i << "\": [";
 
-        std::vector<Edge> edges = *vertex_iter;
+        AdjacencyMatrix::Neighbors edges = adj_matrix[i];
         for (auto edge_iter = edges.begin(); edge_iter != edges.end(); ++edge_iter) {
-            stream << "\"" << edge_iter->source << "->" << edge_iter->target << "\", ";
+            stream << "\"" << i << "->" << edge_iter->target << "\", ";
         }
 
         stream << "],\n";
@@ -1,6 +1,7 @@
 #ifndef UTILS_DEFINITIONS_H
 #define UTILS_DEFINITIONS_H
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <array>
@@ -9,6 +10,8 @@
 #include <limits>
 #include <functional>
 #include <memory>
+#include <cstdint>
+#include <iterator>
 
 
 #ifndef DEBUG
@@ -16,7 +19,32 @@
 #endif
 
 
-const size_t MAX_COST = std::numeric_limits<size_t>::max();
+// Width in bits (32 or 64) of edge and path costs, and of vertex ids. The DIMACS road maps fit
+// in 32 bits, which halves the memory traffic of the graph, heuristic and dominance arrays.
+// Graphs whose path costs could overflow the selected width are rejected when they are loaded (see path_costs_fit).
+#ifndef COST_WIDTH
+    #define COST_WIDTH 64
+#endif
+
+#ifndef VERTEX_ID_WIDTH
+    #define VERTEX_ID_WIDTH 64
+#endif
+
+#if (COST_WIDTH == 32)
+using Cost      = uint32_t;
+#else
+using Cost      = size_t;
+#endif
+
+#if (VERTEX_ID_WIDTH == 32)
+using VertexId  = uint32_t;
+#else
+using VertexId  = size_t;
+#endif
+
+
+const Cost      MAX_COST = std::numeric_limits<Cost>::max();
+const VertexId  MAX_VERTEX_ID = std::numeric_limits<VertexId>::max();
 
 
 template<typename T>
@@ -29,16 +57,80 @@ std::ostream& operator<<(std::ostream &stream, const Pair<T> pair) {
 }
 
 
-using Heuristic = std::function<Pair<size_t>(size_t)>;
+using Heuristic = std::function<Pair<Cost>(size_t)>;
+
+// Heuristic value of a cost to the target: the shortest path heuristics bound the searches by 0.9 of the costs
+inline Cost heuristic_value(Cost cost) {
+    return 0.9 * cost;
+}
+
+// Non-owning view of a flat table of heuristic values per vertex and criterion (see ShortestPathHeuristic), the
+// tables hold them already scaled (see heuristic_value). The searches are compiled for it as well as for
+// Heuristic, there the lookup inlines instead of calling through std::function. The table must outlive the view.
+class HeuristicTableView {
+private:
+    const Pair<Cost>    *table = nullptr;
+
+public:
+    HeuristicTableView() = default;
+    HeuristicTableView(const Pair<Cost> *table) : table(table) {}
+
+    bool is_valid(void) const { return this->table != nullptr; }
+    Pair<Cost> operator()(size_t node_id) const { return this->table[node_id]; }
+};
+
+// HeuristicTableView that also holds lower bounds on weighted sums of the criteria (see WeightedSumHeuristic):
+// per vertex and weight pair w the least w[0]*c1+w[1]*c2 over its paths to the target. Every path of a node
+// within both search bounds has a weighted sum within the same weighted sum of the bounds, so nodes over it are
+// pruned even when neither criterion alone rules them out. The tables must outlive the view.
+class WeightedSumTableView {
+public:
+    static const size_t     WEIGHTS_COUNT = 3;
+    // Weights are at most 2^10 and bounds over 2^50 are not checked, so no sum overflows
+    static const uint64_t   MAX_CHECKED_BOUND = (uint64_t)1 << 50;
+    static const uint64_t   UNREACHABLE_SUM = (uint64_t)1 << 62;
+
+    using Weights = std::array<Pair<uint64_t>, WEIGHTS_COUNT>;
+
+private:
+    HeuristicTableView  costs;
+    const uint64_t      *sums = nullptr;    // WEIGHTS_COUNT per vertex, UNREACHABLE_SUM if there is no path
+    Weights             weights = {};
+
+public:
+    WeightedSumTableView() = default;
+    WeightedSumTableView(HeuristicTableView costs, const uint64_t *sums, const Weights &weights)
+        : costs(costs), sums(sums), weights(weights) {}
+
+    bool is_valid(void) const { return this->sums != nullptr; }
+    Pair<Cost> operator()(size_t node_id) const { return this->costs(node_id); }
+
+    // Whether a node with cost g has no path to the target within both bounds. g is within them,
+    // the search checks each criterion first.
+    bool exceeds_bounds(size_t node_id, const Pair<Cost> &g, const Pair<size_t> &bound) const {
+        if ((bound[0] > MAX_CHECKED_BOUND) || (bound[1] > MAX_CHECKED_BOUND)) {
+            return false;
+        }
+        const uint64_t *vertex_sums = this->sums + node_id*WEIGHTS_COUNT;
+        for (size_t i = 0; i < WEIGHTS_COUNT; ++i) {
+            const Pair<uint64_t> &w = this->weights[i];
+            if (w[0]*g[0] + w[1]*g[1] + vertex_sums[i] > w[0]*bound[0] + w[1]*bound[1]) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
 
 
 // Structs and classes
 struct Edge {
-    size_t          source;
-    size_t          target;
-    Pair<size_t>    cost;
+    VertexId        source;
+    VertexId        target;
+    Pair<Cost>      cost;
 
-    Edge(size_t source, size_t target, Pair<size_t> cost) : source(source), target(target), cost(cost) {}
+    Edge() = default;
+    Edge(VertexId source, VertexId target, Pair<Cost> cost) : source(source), target(target), cost(cost) {}
     Edge inverse() {
         return Edge(this->target, this->source, this->cost);
     }
@@ -46,23 +138,264 @@ struct Edge {
 std::ostream& operator<<(std::ostream &stream, const Edge &edge);
 
 
-// Graph representation as adjacency matrix
+// Change of the costs of the arc source->target, as made by AdjacencyMatrix::update_costs()
+struct CostUpdate {
+    VertexId        source;
+    VertexId        target;
+    Pair<Cost>      old_cost;
+    Pair<Cost>      new_cost;
+
+    CostUpdate inverse() const {
+        return {this->target, this->source, this->old_cost, this->new_cost};
+    }
+};
+
+
+// Graph representation in compressed sparse row (CSR) form. The outgoing edges of
+// vertex v occupy the range [offsets[v], offsets[v+1]) of the targets and cost columns,
+// so iterating the neighbors of a vertex walks contiguous memory.
+// The columns are not owned directly: they live in a shared storage object (heap vectors
+// or a memory mapped snapshot file), which makes copies cheap and allows using a
+// snapshot in place.
+//
+// A graph can also be compressed (see compress()): the edges of each vertex are then sorted by
+// target and stored as a byte stream starting at bytes[byte_offsets[v]], every edge encoded as
+// three LEB128 varints - the zigzag encoded delta from the previous target (the vertex itself
+// for the first edge) and the two costs. operator[] decodes the stream of the vertex up front.
+//
+// In general the edges of v are [offsets[v], end_offsets[v]), for plain CSR graphs end_offsets
+// is simply offsets+1. This lets a forward and a reverse graph share one set of columns where
+// each vertex stores [reverse only arcs | symmetric arcs | forward only arcs] (see share_symmetric_arcs).
 class AdjacencyMatrix {
 private:
-    std::vector<std::vector<Edge>> matrix;
-    size_t                         graph_size;
+    size_t                      graph_size = 0;
+    size_t                      edges_amount = 0;
+    size_t                      stored_edges = 0;
+    const size_t                *offsets = nullptr;
+    const size_t                *end_offsets = nullptr;
+    const VertexId              *targets = nullptr;
+    Pair<const Cost *>          costs = {{nullptr, nullptr}};
+    const size_t                *byte_offsets = nullptr;
+    const uint8_t               *bytes = nullptr;
+    std::shared_ptr<const void> storage;
+    Pair<Cost *>                writable_costs = {{nullptr, nullptr}};  // Set while the cost columns are private heap arrays
+    Pair<size_t>                cost_headroom = {{0, 0}};               // See path_cost_headroom()
+
+    void make_private_copy(void);
 
 public:
+    // Lightweight view of a single outgoing edge, built on the fly from the CSR columns
+    struct EdgeView {
+        VertexId        target;
+        Pair<Cost>      cost;
+    };
+
+    // Walks the target and cost columns of one vertex, plain CSR columns or the edges Neighbors decoded
+    class NeighborIterator {
+    private:
+        const VertexId          *targets;
+        Pair<const Cost *>      costs;
+        size_t                  position;
+
+    public:
+        struct Arrow {
+            EdgeView edge;
+            const EdgeView *operator->() const { return &edge; }
+        };
+
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = EdgeView;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Arrow;
+        using reference         = EdgeView;
+
+        NeighborIterator(const VertexId *targets, Pair<const Cost *> costs, size_t position)
+            : targets(targets), costs(costs), position(position) {}
+        EdgeView operator*() const { return {targets[position], {costs[0][position], costs[1][position]}}; }
+        Arrow operator->() const { return {**this}; }
+        NeighborIterator &operator++() { ++this->position; return *this; }
+        NeighborIterator operator++(int) { NeighborIterator prev = *this; ++(*this); return prev; }
+        bool operator==(const NeighborIterator &other) const { return position == other.position; }
+        bool operator!=(const NeighborIterator &other) const { return position != other.position; }
+    };
+
+    // Range of the outgoing edges of a single vertex. The backend is picked here, once per vertex: plain
+    // graphs iterate their columns in place, compressed graphs decode the edges of the vertex into columns
+    // of the range itself (inline for small degrees), so iterating is the same pointer walk for both.
+    class Neighbors {
+    private:
+        static const size_t     INLINE_EDGES = 16;
+
+        struct DecodedEdges {
+            std::vector<VertexId>   targets;
+            Pair<std::vector<Cost>> costs;
+        };
+
+        const VertexId          *targets;
+        Pair<const Cost *>      costs;
+        size_t                  first;
+        size_t                  last;
+        bool                    decoded = false;
+        VertexId                inline_targets[INLINE_EDGES];
+        Cost                    inline_costs[2][INLINE_EDGES];
+        std::unique_ptr<DecodedEdges> heap_edges;   // Decoded edges past INLINE_EDGES
+
+        VertexId *decoded_targets(void) {
+            return (this->last <= INLINE_EDGES) ? this->inline_targets : this->heap_edges->targets.data();
+        }
+        Cost *decoded_costs(size_t cost_idx) {
+            return (this->last <= INLINE_EDGES) ? this->inline_costs[cost_idx] : this->heap_edges->costs[cost_idx].data();
+        }
+        void use_decoded(void) {
+            this->targets = this->decoded_targets();
+            this->costs = {{this->decoded_costs(0), this->decoded_costs(1)}};
+        }
+
+        void decode(const AdjacencyMatrix *graph, size_t vertex_id);
+
+        // Copies of a decoded range point at their own columns
+        void copy_from(const Neighbors &other) {
+            this->targets = other.targets;
+            this->costs = other.costs;
+            this->first = other.first;
+            this->last = other.last;
+            this->decoded = other.decoded;
+            if (this->decoded) {
+                if (this->last > INLINE_EDGES) {
+                    this->heap_edges.reset(new DecodedEdges(*other.heap_edges));
+                } else {
+                    std::copy(other.inline_targets, other.inline_targets + this->last, this->inline_targets);
+                    std::copy(other.inline_costs[0], other.inline_costs[0] + this->last, this->inline_costs[0]);
+                    std::copy(other.inline_costs[1], other.inline_costs[1] + this->last, this->inline_costs[1]);
+                }
+                this->use_decoded();
+            }
+        }
+
+    public:
+        Neighbors(const AdjacencyMatrix *graph, size_t vertex_id, size_t first, size_t last)
+            : targets(graph->targets), costs(graph->costs), first(first), last(last) {
+            if (graph->bytes != nullptr) {
+                this->decode(graph, vertex_id);
+            }
+        }
+        Neighbors(const Neighbors &other) { this->copy_from(other); }
+        Neighbors &operator=(const Neighbors &other) {
+            if (this != &other) {
+                this->copy_from(other);
+            }
+            return *this;
+        }
+        NeighborIterator begin() const { return NeighborIterator(targets, costs, first); }
+        NeighborIterator end() const { return NeighborIterator(targets, costs, last); }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+
     AdjacencyMatrix() = default;
     AdjacencyMatrix(size_t graph_size, std::vector<Edge> &edges, bool inverse=false);
-    void add(Edge edge);
+    // Wraps existing CSR columns, `storage` keeps the memory behind them alive
+    AdjacencyMatrix(size_t graph_size, size_t edges_count, const size_t *offsets, const VertexId *targets,
+                    Pair<const Cost *> costs, std::shared_ptr<const void> storage);
     size_t size(void) const;
-    const std::vector<Edge>& operator[](size_t vertex_id) const;
+    size_t edges_count(void) const;
+    // Upper bound on the cost of any simple path per criterion: the sum of the costliest
+    // outgoing edge of every vertex (saturated at the size_t maximum). Cheap, but far above the
+    // real path costs of large maps.
+    Pair<size_t> path_cost_bound(void) const;
+
+    // Returns a compressed copy of the graph, iterating it yields the edges of each vertex sorted by target
+    AdjacencyMatrix compress(void) const;
+    bool is_compressed(void) const;
+    // True for plain CSR layout, where the raw columns below describe exactly this graph
+    bool is_contiguous(void) const;
+    // Bytes used by the graph arrays, graphs sharing storage report the shared arrays
+    size_t memory_usage(void) const;
+    bool shares_storage_with(const AdjacencyMatrix &other) const;
+
+    // Sets the costs of the arcs source->target (every parallel arc between the two) and returns the
+    // changes made, arcs that do not exist or keep their costs are skipped. The columns are written in
+    // place when this graph is their only user. Graphs sharing their columns (copies, the reverse graph,
+    // mapped snapshots) or compressed graphs are first copied to private plain storage, the other users
+    // keep the old costs. Path costs are not checked, see update_edge_costs().
+    std::vector<CostUpdate> update_costs(const std::vector<Edge> &updates);
+    // How much the arc costs may still grow in total per criterion before path_costs_fit() must be checked again,
+    // as left by update_edge_costs(). 0 until then, update_costs() resets it for the criteria whose costs grew.
+    Pair<size_t> path_cost_headroom(void) const;
+    void set_path_cost_headroom(Pair<size_t> headroom);
+
+    // Raw CSR columns, offsets has size()+2 entries and the other columns edges_count().
+    // Compressed graphs have no targets and costs columns (nullptr), and the columns of graphs
+    // sharing their symmetric arcs hold both directions (see is_contiguous).
+    const size_t *offsets_data(void) const { return this->offsets; }
+    const VertexId *targets_data(void) const { return this->targets; }
+    const Cost *costs_data(size_t cost_idx) const { return this->costs[cost_idx]; }
+    Neighbors operator[](size_t vertex_id) const {
+        return Neighbors(this, vertex_id, this->offsets[vertex_id], this->end_offsets[vertex_id]);
+    }
 
+    friend double share_symmetric_arcs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph);
     friend std::ostream& operator<<(std::ostream &stream, const AdjacencyMatrix &adj_matrix);
 };
 
 
+// Road networks are almost entirely symmetric: most arcs u->v have a v->u twin with the same costs.
+// Replaces the graph and its reverse with two views over a single set of columns, where every
+// symmetric arc is stored once and only the asymmetric arcs are stored per direction.
+// The edges of each vertex are reordered by target. Returns the fraction of symmetric arcs.
+double share_symmetric_arcs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph);
+
+
+// Whether the searches of a graph can accumulate its path costs in the Cost type: the cheap path_cost_bound()
+// fits, or else every shortest path cost and every arc cost stays below half of MAX_COST, which leaves the
+// searches room for paths twice as costly. Shortest path costs are bounded through one vertex, by the costliest shortest path
+// to it plus the costliest from it (four one-to-all searches). Paths among the vertices that do not reach the
+// vertex, or are not reached from it, are bounded by the sum of their costliest arcs instead.
+bool path_costs_fit(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph);
+// The same check, also giving how much the arc costs may grow in total per criterion while it still holds. Path
+// costs grow by at most the growth of the arc costs, so the bounds it checked stay below their limits.
+bool path_costs_fit(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph, Pair<size_t> &headroom);
+
+
+// Applies a batch of new arc costs (given as forward arcs) to a graph and its reverse, see update_costs().
+// `changes` gets the changes in the direction of `graph`, to be passed on to the heuristics computed on them.
+// Returns false, with no costs changed, when the new path costs would no longer fit (see path_costs_fit).
+// Batches whose cost growth fits the headroom left by the last check of `graph` skip the check, the graphs are
+// searched again only once the headroom is used up (see AdjacencyMatrix::path_cost_headroom).
+bool update_edge_costs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph, const std::vector<Edge> &updates,
+                       std::vector<CostUpdate> &changes);
+
+
+// Builds an AdjacencyMatrix in two passes over the edges, without an intermediate edge list:
+// count_edge() for every edge, allocate(), then add_edge() for the same edges in the same order.
+// The per vertex order of the added edges is kept.
+// Edges can also be placed concurrently: count_edges() per vertex (calls for distinct vertices may run
+// concurrently once reserve() sized the counts), allocate(), then place_edge() into the slots following
+// edges_begin() of the source, and build_placed() instead of build().
+struct CSRArrays;
+class AdjacencyMatrixBuilder {
+private:
+    std::shared_ptr<CSRArrays>  arrays;
+    size_t                      graph_size = 0;
+    size_t                      edges_amount = 0;
+
+    AdjacencyMatrix take_graph(void);
+
+public:
+    AdjacencyMatrixBuilder(size_t graph_size_hint=0);
+    void reserve(size_t graph_size);
+    void count_edge(size_t source);
+    void count_edges(size_t source, size_t count);
+    void allocate(size_t graph_size);
+    void add_edge(size_t source, size_t target, Pair<Cost> cost);
+    AdjacencyMatrix build(void);
+
+    size_t edges_begin(size_t source) const;
+    void place_edge(size_t slot, size_t target, Pair<Cost> cost);
+    AdjacencyMatrix build_placed(void);
+};
+
+
 struct Node;
 struct PathPair;
 using NodePtr       = std::shared_ptr<Node>;
@@ -72,22 +405,23 @@ using PPSolutionSet = std::vector<PathPairPtr>;
 
 
 struct Node {
-    size_t          id;
-    Pair<size_t>    g;
-    Pair<size_t>    h;
-    //TODO change between double and size_t
+    VertexId        id;
+    Pair<Cost>      g;
+    Pair<Cost>      h;
+    //TODO change between double and Cost
     Pair<double>    f;
-//    Pair<size_t>    f;
+//    Pair<Cost>      f;
     NodePtr         parent;
 
     //TODO change heuristic
-    Node(size_t id, Pair<size_t> g, Pair<size_t> h, Pair<size_t> b, NodePtr parent=nullptr)
+    Node(size_t id, Pair<Cost> g, Pair<Cost> h, Pair<size_t> b, NodePtr parent=nullptr)
         : id(id), g(g), h(h), f({((double)h[0]) / ((double)(b[0]-g[0])), ((double)h[1]) / ((double)(b[1]-g[1]))}), parent(parent) {
         //std::cout << "f: " << f << std::endl;
     };
 
-//    Node(size_t id, Pair<size_t> g, Pair<size_t> h, Pair<size_t> b, NodePtr parent=nullptr)
-//            : id(id), g(g), h(h), f({g[0]+h[0],g[1]+h[1]}), parent(parent) {};
+    // Unbounded variant (used by PPA), f is the plain g+h estimate
+    Node(size_t id, Pair<Cost> g, Pair<Cost> h, NodePtr parent=nullptr)
+            : id(id), g(g), h(h), f({(double)g[0]+h[0], (double)g[1]+h[1]}), parent(parent) {};
 
     struct more_than_specific_heurisitic_cost {
         size_t cost_idx;
@@ -129,7 +463,7 @@ struct Node {
 
 
 struct PathPair {
-    size_t      id;
+    VertexId    id;
     NodePtr     top_left;
     NodePtr     bottom_right;
     NodePtr     parent;
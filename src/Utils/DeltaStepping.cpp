@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "DeltaStepping.h"
+#include "HugePages.h"
+
+namespace {
+
+const Cost NO_BUCKET = MAX_COST;
+// Vertices are dealt to the workers in runs of consecutive ids, so neighbouring vertices of
+// locality ordered graphs (see GraphReordering.h) mostly have the same owner
+const size_t OWNER_RUN = 64;
+// Vertices sampled to pick delta
+const size_t DELTA_SAMPLES = 4096;
+
+
+class Barrier {
+private:
+    std::mutex              mutex;
+    std::condition_variable released;
+    size_t                  threads;
+    size_t                  waiting = 0;
+    size_t                  generation = 0;
+
+public:
+    Barrier(size_t threads) : threads(threads) {}
+
+    void wait(void) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        size_t arrival_generation = this->generation;
+        if (++this->waiting == this->threads) {
+            this->waiting = 0;
+            this->generation++;
+            this->released.notify_all();
+            return;
+        }
+        this->released.wait(lock, [&]() { return this->generation != arrival_generation; });
+    }
+};
+
+
+struct Request {
+    VertexId    target;
+    VertexId    parent;
+    Cost        distance;
+};
+
+
+struct Worker {
+    std::deque<std::vector<VertexId>>   buckets;        // buckets[i] holds the owned vertices of bucket first_bucket+i
+    Cost                                first_bucket = 0;
+    std::vector<VertexId>               frontier;
+    std::vector<VertexId>               settled;        // Taken from the current bucket, their heavy arcs are relaxed last
+    std::vector<std::vector<Request>>   outbox;         // Relaxations of the vertices of every owner
+    bool                                busy = false;
+    Cost                                next_bucket = NO_BUCKET;
+};
+
+
+class DeltaStepping {
+private:
+    const AdjacencyMatrix   &graph;
+    size_t                  cost_idx;
+    Cost                    delta;
+    Pair<Cost>              *distances;
+    VertexId                *parents;
+    HugePageVector<Cost>    bucket_of;      // Bucket an owned vertex is queued in, entries elsewhere are stale
+    HugePageVector<Cost>    settled_in;     // Last bucket an owned vertex was settled in
+    std::vector<Worker>     workers;
+    Barrier                 barrier;
+
+    size_t owner(size_t vertex) const {
+        return (vertex / OWNER_RUN) % this->workers.size();
+    }
+
+    void insert(Worker &worker, size_t vertex, Cost bucket) {
+        if (this->bucket_of[vertex] == bucket) {
+            return;
+        }
+        this->bucket_of[vertex] = bucket;
+        if (worker.buckets.empty()) {
+            worker.first_bucket = bucket;
+        }
+        for (; worker.first_bucket > bucket; --worker.first_bucket) {
+            worker.buckets.emplace_front();
+        }
+        if (bucket - worker.first_bucket >= worker.buckets.size()) {
+            worker.buckets.resize(bucket - worker.first_bucket + 1);
+        }
+        worker.buckets[bucket - worker.first_bucket].push_back((VertexId)vertex);
+    }
+
+    void relax(Worker &worker, size_t vertex, bool light) {
+        Cost distance = this->distances[vertex][this->cost_idx];
+        const AdjacencyMatrix::Neighbors outgoing_edges = this->graph[vertex];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+            Cost cost = p_edge->cost[this->cost_idx];
+            if ((cost <= this->delta) == light) {
+                worker.outbox[this->owner(p_edge->target)].push_back({p_edge->target, (VertexId)vertex, distance + cost});
+            }
+        }
+    }
+
+    void apply_requests(size_t worker_index) {
+        Worker &worker = this->workers[worker_index];
+        for (auto sender = this->workers.begin(); sender != this->workers.end(); ++sender) {
+            std::vector<Request> &requests = sender->outbox[worker_index];
+            for (auto request = requests.begin(); request != requests.end(); ++request) {
+                Cost &distance = this->distances[request->target][this->cost_idx];
+                if (request->distance < distance) {
+                    distance = request->distance;
+                    if (this->parents != nullptr) {
+                        this->parents[request->target] = request->parent;
+                    }
+                    this->insert(worker, request->target, request->distance / this->delta);
+                } else if ((this->parents != nullptr) && (request->distance == distance) &&
+                           (request->parent < this->parents[request->target])) {
+                    this->parents[request->target] = request->parent;
+                }
+            }
+            requests.clear();
+        }
+    }
+
+    Cost first_queued_bucket(const Worker &worker) const {
+        for (size_t i = 0; i < worker.buckets.size(); ++i) {
+            if (worker.buckets[i].empty() == false) {
+                return worker.first_bucket + i;
+            }
+        }
+        return NO_BUCKET;
+    }
+
+    void run(size_t worker_index) {
+        Worker &worker = this->workers[worker_index];
+        while (true) {
+            worker.next_bucket = this->first_queued_bucket(worker);
+            this->barrier.wait();
+            Cost current = NO_BUCKET;
+            for (auto other = this->workers.begin(); other != this->workers.end(); ++other) {
+                current = std::min(current, other->next_bucket);
+            }
+            if (current == NO_BUCKET) {
+                return;
+            }
+            while ((worker.buckets.empty() == false) && (worker.first_bucket < current)) {
+                worker.buckets.pop_front();
+                worker.first_bucket++;
+            }
+
+            // Light rounds, relaxations may put vertices back into the current bucket
+            bool busy = true;
+            while (busy) {
+                worker.frontier.clear();
+                if ((worker.buckets.empty() == false) && (worker.first_bucket == current)) {
+                    worker.frontier.swap(worker.buckets.front());
+                }
+                for (auto p_vertex = worker.frontier.begin(); p_vertex != worker.frontier.end(); ++p_vertex) {
+                    if (this->bucket_of[*p_vertex] != current) {
+                        continue;
+                    }
+                    this->bucket_of[*p_vertex] = NO_BUCKET;
+                    if (this->settled_in[*p_vertex] != current) {
+                        this->settled_in[*p_vertex] = current;
+                        worker.settled.push_back(*p_vertex);
+                    }
+                    this->relax(worker, *p_vertex, true);
+                }
+                this->barrier.wait();
+                this->apply_requests(worker_index);
+                worker.busy = (worker.buckets.empty() == false) && (worker.first_bucket == current) &&
+                              (worker.buckets.front().empty() == false);
+                this->barrier.wait();
+                busy = false;
+                for (auto other = this->workers.begin(); other != this->workers.end(); ++other) {
+                    busy |= other->busy;
+                }
+            }
+
+            // The distances of the bucket are final now, heavy arcs only reach later buckets
+            for (auto p_vertex = worker.settled.begin(); p_vertex != worker.settled.end(); ++p_vertex) {
+                this->relax(worker, *p_vertex, false);
+            }
+            worker.settled.clear();
+            this->barrier.wait();
+            this->apply_requests(worker_index);
+        }
+    }
+
+public:
+    DeltaStepping(const AdjacencyMatrix &graph, size_t cost_idx, size_t threads, Cost delta,
+                  Pair<Cost> *distances, VertexId *parents)
+        : graph(graph), cost_idx(cost_idx), delta(delta), distances(distances), parents(parents),
+          bucket_of(graph.size()+1, NO_BUCKET), settled_in(graph.size()+1, NO_BUCKET), workers(threads),
+          barrier(threads) {
+        for (auto worker = this->workers.begin(); worker != this->workers.end(); ++worker) {
+            worker->outbox.resize(threads);
+        }
+    }
+
+    void operator()(size_t source) {
+        for (size_t vertex = 0; vertex <= this->graph.size(); ++vertex) {
+            this->distances[vertex][this->cost_idx] = MAX_COST;
+        }
+        if (this->parents != nullptr) {
+            std::fill(this->parents, this->parents + this->graph.size()+1, MAX_VERTEX_ID);
+        }
+        this->distances[source][this->cost_idx] = 0;
+        this->insert(this->workers[this->owner(source)], source, 0);
+
+        std::vector<std::thread> threads;
+        for (size_t worker_index = 1; worker_index < this->workers.size(); ++worker_index) {
+            threads.emplace_back(&DeltaStepping::run, this, worker_index);
+        }
+        this->run(0);
+        for (auto thread = threads.begin(); thread != threads.end(); ++thread) {
+            thread->join();
+        }
+    }
+};
+
+
+// Twice the average arc cost of a sample of vertices: light arcs then cover the typical road
+// segment, while buckets stay narrow enough to keep the rounds short
+Cost pick_delta(const AdjacencyMatrix &graph, size_t cost_idx) {
+    size_t step = std::max<size_t>(1, (graph.size()+1) / DELTA_SAMPLES);
+    size_t arcs = 0;
+    double total_cost = 0;
+    for (size_t vertex = 0; vertex <= graph.size(); vertex += step) {
+        AdjacencyMatrix::Neighbors outgoing_edges = graph[vertex];
+        for (auto p_edge = outgoing_edges.begin(); p_edge != outgoing_edges.end(); ++p_edge) {
+            total_cost += p_edge->cost[cost_idx];
+            arcs++;
+        }
+    }
+    return std::max<Cost>(1, (arcs == 0) ? 1 : (Cost)(2 * total_cost / arcs));
+}
+
+} // namespace
+
+
+void delta_stepping(const AdjacencyMatrix &graph, size_t source, size_t cost_idx, size_t threads,
+                    Pair<Cost> *distances, VertexId *parents, Cost delta) {
+    if (delta == 0) {
+        delta = pick_delta(graph, cost_idx);
+    }
+    DeltaStepping search(graph, cost_idx, std::max<size_t>(1, threads), delta, distances, parents);
+    search(source);
+}
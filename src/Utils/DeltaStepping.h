@@ -0,0 +1,19 @@
+#ifndef UTILS_DELTA_STEPPING_H
+#define UTILS_DELTA_STEPPING_H
+
+#include "Definitions.h"
+
+// Parallel one-to-all shortest paths for a single criterion (delta-stepping, Meyer and Sanders).
+// Vertices are bucketed by distance/delta and each bucket is settled in rounds: all vertices of the
+// bucket relax their light arcs (cost <= delta) in parallel until the bucket stays empty, then their
+// heavy arcs once. Every worker owns a fixed share of the vertices and is the only one writing
+// their distances, relaxations are passed to the owner as requests between barriers.
+//
+// Writes the distance of every vertex from `source` to distances[v][cost_idx] (MAX_COST if
+// unreachable), the same values as a sequential Dijkstra, and unless `parents` is null a shortest path tree to
+// parents[v] (MAX_VERTEX_ID for none), where ties go to the smallest parent id. Both arrays have graph.size()+1 entries.
+// `delta` 0 picks one from the arc costs of the graph.
+void delta_stepping(const AdjacencyMatrix &graph, size_t source, size_t cost_idx, size_t threads,
+                    Pair<Cost> *distances, VertexId *parents, Cost delta=0);
+
+#endif //UTILS_DELTA_STEPPING_H
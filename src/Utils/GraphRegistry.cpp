@@ -0,0 +1,96 @@
+#include "GraphRegistry.h"
+
+
+size_t MapGraphs::memory_usage() const {
+    if (this->graph.shares_storage_with(this->inv_graph)) {
+        return this->graph.memory_usage();
+    }
+    return this->graph.memory_usage() + this->inv_graph.memory_usage();
+}
+
+
+GraphRegistry::GraphRegistry(Loader loader, size_t memory_budget)
+    : loader(loader), memory_budget(memory_budget) {}
+
+
+MapGraphsPtr GraphRegistry::get(const std::string &map) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    auto entry = this->entries.find(map);
+    if (entry != this->entries.end()) {
+        this->lru.splice(this->lru.begin(), this->lru, entry->second.lru_position);
+        std::shared_future<MapGraphsPtr> graphs = entry->second.graphs;
+        lock.unlock();
+        return graphs.get(); // Waits if another thread is still loading the map
+    }
+
+    // Register the pending load, so other requests for the map wait for it instead of loading again
+    std::promise<MapGraphsPtr> loaded;
+    this->lru.push_front(map);
+    this->entries[map] = {loaded.get_future().share(), 0, this->lru.begin()};
+    lock.unlock();
+
+    std::shared_ptr<MapGraphs> graphs = std::make_shared<MapGraphs>();
+    bool success;
+    try {
+        success = this->loader(map, graphs->graph, graphs->inv_graph);
+    } catch (...) {
+        success = false;
+    }
+    if (success == false) {
+        graphs = nullptr;
+    }
+    loaded.set_value(graphs);
+
+    lock.lock();
+    entry = this->entries.find(map);
+    if (graphs == nullptr) {
+        // Failed loads are not cached, a later request tries again
+        this->lru.erase(entry->second.lru_position);
+        this->entries.erase(entry);
+        return nullptr;
+    }
+    entry->second.memory = graphs->memory_usage();
+    this->resident_memory += entry->second.memory;
+    this->evict_over_budget();
+    return graphs;
+}
+
+
+void GraphRegistry::evict_over_budget() {
+    // The most recently used map is kept even if it exceeds the budget on its own.
+    // Maps still loading have no memory accounted yet and are skipped.
+    auto candidate = this->lru.end();
+    while ((this->resident_memory > this->memory_budget) && (candidate != this->lru.begin())) {
+        --candidate;
+        if (candidate == this->lru.begin()) {
+            break;
+        }
+
+        auto entry = this->entries.find(*candidate);
+        if (entry->second.memory == 0) {
+            continue;
+        }
+        this->resident_memory -= entry->second.memory;
+        this->entries.erase(entry);
+        candidate = this->lru.erase(candidate);
+    }
+}
+
+
+void GraphRegistry::set_memory_budget(size_t memory_budget) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->memory_budget = memory_budget;
+    this->evict_over_budget();
+}
+
+
+size_t GraphRegistry::memory_usage() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->resident_memory;
+}
+
+
+bool GraphRegistry::is_resident(const std::string &map) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->entries.find(map) != this->entries.end();
+}
@@ -0,0 +1,60 @@
+#ifndef UTILS_GRAPH_REGISTRY_H
+#define UTILS_GRAPH_REGISTRY_H
+
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Definitions.h"
+
+// The forward and reverse graphs of a map
+struct MapGraphs {
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+
+    size_t memory_usage(void) const;
+};
+using MapGraphsPtr = std::shared_ptr<const MapGraphs>;
+
+
+// Process wide cache of loaded maps. A map is loaded on its first use and handed out as a shared
+// read only handle, later requests reuse it. Resident maps are kept under a memory budget by evicting
+// the least recently used ones, the memory of an evicted map is released once its last handle is dropped.
+// Safe to use from several threads, concurrent requests for a loading map wait for that single load.
+class GraphRegistry {
+public:
+    using Loader = std::function<bool(const std::string &map, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph)>;
+
+private:
+    struct Entry {
+        std::shared_future<MapGraphsPtr>    graphs;
+        size_t                              memory;
+        std::list<std::string>::iterator    lru_position;
+    };
+
+    mutable std::mutex                  mutex;
+    Loader                              loader;
+    size_t                              memory_budget;
+    size_t                              resident_memory = 0;
+    std::map<std::string, Entry>        entries;
+    std::list<std::string>              lru;            // Most recently used first
+
+    void evict_over_budget(void);
+
+public:
+    GraphRegistry(Loader loader, size_t memory_budget=SIZE_MAX);
+    GraphRegistry(const GraphRegistry &) = delete;
+    GraphRegistry& operator=(const GraphRegistry &) = delete;
+
+    // Returns nullptr if the map could not be loaded
+    MapGraphsPtr get(const std::string &map);
+    // Evicts maps until the resident ones fit the new budget
+    void set_memory_budget(size_t memory_budget);
+    size_t memory_usage(void) const;
+    bool is_resident(const std::string &map) const;
+};
+
+#endif //UTILS_GRAPH_REGISTRY_H
@@ -0,0 +1,121 @@
+#include <deque>
+#include <algorithm>
+
+#include "GraphReordering.h"
+
+
+VertexOrdering::VertexOrdering(const std::vector<VertexId> &new_ids)
+    : new_ids(new_ids), old_ids(new_ids.size()) {
+    for (size_t original_id = 0; original_id < new_ids.size(); ++original_id) {
+        this->old_ids[new_ids[original_id]] = (VertexId)original_id;
+    }
+}
+
+
+size_t VertexOrdering::to_internal(size_t original_id) const {
+    return this->new_ids.empty() ? original_id : this->new_ids.at(original_id);
+}
+
+
+size_t VertexOrdering::to_original(size_t internal_id) const {
+    return this->old_ids.empty() ? internal_id : this->old_ids.at(internal_id);
+}
+
+
+AdjacencyMatrix VertexOrdering::permute(const AdjacencyMatrix &graph) const {
+    AdjacencyMatrixBuilder builder(graph.size());
+    for (size_t internal_id = 0; internal_id <= graph.size(); ++internal_id) {
+        AdjacencyMatrix::Neighbors edges = graph[this->to_original(internal_id)];
+        for (size_t i = 0; i < edges.size(); ++i) {
+            builder.count_edge(internal_id);
+        }
+    }
+
+    builder.allocate(graph.size());
+    for (size_t internal_id = 0; internal_id <= graph.size(); ++internal_id) {
+        AdjacencyMatrix::Neighbors edges = graph[this->to_original(internal_id)];
+        for (auto p_edge = edges.begin(); p_edge != edges.end(); ++p_edge) {
+            builder.add_edge(internal_id, this->to_internal(p_edge->target), p_edge->cost);
+        }
+    }
+    return builder.build();
+}
+
+
+std::vector<Pair<double>> VertexOrdering::permute(const std::vector<Pair<double>> &coordinates) const {
+    std::vector<Pair<double>> permuted(coordinates.size());
+    for (size_t internal_id = 0; internal_id < coordinates.size(); ++internal_id) {
+        permuted[internal_id] = coordinates[this->to_original(internal_id)];
+    }
+    return permuted;
+}
+
+
+void VertexOrdering::translate_queries(std::vector<std::pair<size_t, size_t>> &queries) const {
+    for (auto query = queries.begin(); query != queries.end(); ++query) {
+        query->first = this->to_internal(query->first);
+        query->second = this->to_internal(query->second);
+    }
+}
+
+
+NodePtr VertexOrdering::to_original(const NodePtr &solution) const {
+    // Collect the path iteratively (paths can be thousands of vertices long) and rebuild it from the source
+    std::vector<NodePtr> path;
+    for (NodePtr node = solution; node != nullptr; node = node->parent) {
+        path.push_back(node);
+    }
+
+    NodePtr parent = nullptr;
+    for (auto node = path.rbegin(); node != path.rend(); ++node) {
+        NodePtr relabeled = std::make_shared<Node>(**node);
+        relabeled->id = (VertexId)this->to_original((*node)->id);
+        relabeled->parent = parent;
+        parent = relabeled;
+    }
+    return parent;
+}
+
+
+SolutionSet VertexOrdering::to_original(const SolutionSet &solutions) const {
+    SolutionSet relabeled;
+    for (auto solution = solutions.begin(); solution != solutions.end(); ++solution) {
+        relabeled.push_back(this->to_original(*solution));
+    }
+    return relabeled;
+}
+
+
+VertexOrdering bfs_ordering(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph) {
+    const VertexId UNVISITED = MAX_VERTEX_ID;
+    std::vector<VertexId> new_ids(graph.size()+1, UNVISITED);
+    std::deque<size_t> queue;
+    VertexId next_id = 0;
+
+    new_ids[0] = next_id++;
+    for (size_t root = 1; root <= graph.size(); ++root) {
+        if (new_ids[root] != UNVISITED) {
+            continue;
+        }
+
+        // Each connected component is numbered contiguously, starting from its lowest original id
+        new_ids[root] = next_id++;
+        queue.push_back(root);
+        while (queue.empty() == false) {
+            size_t vertex = queue.front();
+            queue.pop_front();
+
+            for (const AdjacencyMatrix *adjacency : {&graph, &inv_graph}) {
+                AdjacencyMatrix::Neighbors edges = (*adjacency)[vertex];
+                for (auto p_edge = edges.begin(); p_edge != edges.end(); ++p_edge) {
+                    if (new_ids[p_edge->target] == UNVISITED) {
+                        new_ids[p_edge->target] = next_id++;
+                        queue.push_back(p_edge->target);
+                    }
+                }
+            }
+        }
+    }
+
+    return VertexOrdering(new_ids);
+}
@@ -0,0 +1,35 @@
+#ifndef UTILS_GRAPH_REORDERING_H
+#define UTILS_GRAPH_REORDERING_H
+
+#include <vector>
+#include "Definitions.h"
+
+// Renumbering of the graph vertices. Searches run on the permuted graph (internal ids), while
+// queries and solutions are translated from/to the original DIMACS ids at the boundary.
+// Vertex 0 is not used by DIMACS graphs and is always kept in place.
+class VertexOrdering {
+private:
+    std::vector<VertexId>   new_ids;    // original id -> internal id
+    std::vector<VertexId>   old_ids;    // internal id -> original id
+
+public:
+    VertexOrdering() = default;
+    VertexOrdering(const std::vector<VertexId> &new_ids);
+
+    size_t to_internal(size_t original_id) const;
+    size_t to_original(size_t internal_id) const;
+
+    AdjacencyMatrix permute(const AdjacencyMatrix &graph) const;
+    std::vector<Pair<double>> permute(const std::vector<Pair<double>> &coordinates) const;
+    void translate_queries(std::vector<std::pair<size_t, size_t>> &queries) const;
+    // Copies a solution path, with all of its nodes relabeled to the original ids
+    NodePtr to_original(const NodePtr &solution) const;
+    SolutionSet to_original(const SolutionSet &solutions) const;
+};
+
+// Breadth first ordering over the undirected version of the graph. Road networks are near planar,
+// so vertices that are close in the graph get close ids, and the per vertex arrays touched while
+// expanding a search frontier (adjacency, heuristic, min_g2) are accessed with good locality.
+VertexOrdering bfs_ordering(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph);
+
+#endif //UTILS_GRAPH_REORDERING_H
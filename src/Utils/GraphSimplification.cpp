@@ -0,0 +1,232 @@
+#include <algorithm>
+
+#include "GraphSimplification.h"
+
+namespace {
+
+const size_t NO_CHAIN = SIZE_MAX;
+
+// An outgoing arc considered for the simplified graph, either an original arc or a contracted chain
+struct ArcCandidate {
+    VertexId    target;
+    Pair<Cost>  cost;
+    size_t      chain;
+};
+
+
+// Keeps only the arcs that are not weakly dominated by another arc to the same target.
+// On equal costs an original arc is preferred over a chain. The survivors are sorted by target and cost.
+void keep_pareto_arcs(std::vector<ArcCandidate> &arcs) {
+    std::sort(arcs.begin(), arcs.end(), [](const ArcCandidate &a, const ArcCandidate &b) {
+        if (a.target != b.target) {
+            return a.target < b.target;
+        }
+        if (a.cost[0] != b.cost[0]) {
+            return a.cost[0] < b.cost[0];
+        }
+        if (a.cost[1] != b.cost[1]) {
+            return a.cost[1] < b.cost[1];
+        }
+        return (a.chain == NO_CHAIN) && (b.chain != NO_CHAIN);
+    });
+
+    // Sorted by the first cost, an arc survives only if it improves the best second cost of its target so far
+    size_t kept = 0;
+    for (size_t i = 0; i < arcs.size(); ++i) {
+        if ((kept == 0) || (arcs[kept-1].target != arcs[i].target) || (arcs[i].cost[1] < arcs[kept-1].cost[1])) {
+            arcs[kept++] = arcs[i];
+        }
+    }
+    arcs.resize(kept);
+}
+
+
+// Vertex with exactly two neighbours that is only passed through: either one way (a->v->b)
+// or two way (a<->v<->b). Such vertices are never a decision point of a search.
+bool is_chain_vertex(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph, size_t vertex) {
+    AdjacencyMatrix::Neighbors out_edges = graph[vertex];
+    AdjacencyMatrix::Neighbors in_edges = inv_graph[vertex];
+    if ((out_edges.size() == 1) && (in_edges.size() == 1)) {
+        return out_edges.begin()->target != in_edges.begin()->target;
+    }
+    if ((out_edges.size() != 2) || (in_edges.size() != 2)) {
+        return false;
+    }
+
+    auto p_out = out_edges.begin();
+    size_t out_first = p_out->target;
+    size_t out_second = (++p_out)->target;
+    auto p_in = in_edges.begin();
+    size_t in_first = p_in->target;
+    size_t in_second = (++p_in)->target;
+    return (out_first != out_second) &&
+           (((in_first == out_first) && (in_second == out_second)) ||
+            ((in_first == out_second) && (in_second == out_first)));
+}
+
+} // namespace
+
+
+const GraphSimplification::ChainArc *GraphSimplification::find_chain(size_t source, size_t target,
+                                                                     Pair<Cost> cost) const {
+    ChainArc key = {(VertexId)source, (VertexId)target, cost, 0, 0};
+    auto arc_order = [](const ChainArc &a, const ChainArc &b) {
+        if (a.source != b.source) {
+            return a.source < b.source;
+        }
+        if (a.target != b.target) {
+            return a.target < b.target;
+        }
+        return a.cost < b.cost;
+    };
+
+    auto p_arc = std::lower_bound(this->chain_arcs.begin(), this->chain_arcs.end(), key, arc_order);
+    if ((p_arc == this->chain_arcs.end()) || arc_order(key, *p_arc)) {
+        return nullptr;
+    }
+    return &(*p_arc);
+}
+
+
+size_t GraphSimplification::contracted_vertices() const {return this->contracted;}
+
+
+size_t GraphSimplification::removed_edges() const {return this->removed_arcs;}
+
+
+NodePtr GraphSimplification::expand(const NodePtr &solution) const {
+    // Collect the path iteratively (paths can be thousands of vertices long) and rebuild it from the source
+    std::vector<NodePtr> path;
+    for (NodePtr node = solution; node != nullptr; node = node->parent) {
+        path.push_back(node);
+    }
+
+    NodePtr parent = nullptr;
+    for (auto node = path.rbegin(); node != path.rend(); ++node) {
+        if (parent != nullptr) {
+            Pair<Cost> arc_cost = {(*node)->g[0] - parent->g[0], (*node)->g[1] - parent->g[1]};
+            const ChainArc *chain = this->find_chain(parent->id, (*node)->id, arc_cost);
+            Pair<Cost> chain_g = parent->g;
+            for (size_t i = (chain != nullptr) ? chain->first_vertex : 0;
+                 (chain != nullptr) && (i < chain->last_vertex); ++i) {
+                Pair<Cost> g = {chain_g[0] + this->chain_costs[i][0], chain_g[1] + this->chain_costs[i][1]};
+                parent = std::make_shared<Node>(this->chain_vertices[i], g, Pair<Cost>({0, 0}), parent);
+            }
+        }
+
+        NodePtr copy = std::make_shared<Node>(**node);
+        copy->parent = parent;
+        parent = copy;
+    }
+    return parent;
+}
+
+
+SolutionSet GraphSimplification::expand(const SolutionSet &solutions) const {
+    SolutionSet expanded;
+    for (auto solution = solutions.begin(); solution != solutions.end(); ++solution) {
+        expanded.push_back(this->expand(*solution));
+    }
+    return expanded;
+}
+
+
+GraphSimplification simplify_graphs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph,
+                                    const std::vector<size_t> &kept_vertices) {
+    size_t graph_size = graph.size();
+    size_t original_edges = graph.edges_count();
+    std::vector<ArcCandidate> arcs;
+
+    // Drop self loops and dominated parallel arcs first, they would hide chain vertices
+    std::vector<Edge> edges;
+    edges.reserve(original_edges);
+    for (size_t source = 0; source <= graph_size; ++source) {
+        arcs.clear();
+        AdjacencyMatrix::Neighbors out_edges = graph[source];
+        for (auto p_edge = out_edges.begin(); p_edge != out_edges.end(); ++p_edge) {
+            if (p_edge->target != source) {
+                arcs.push_back({p_edge->target, p_edge->cost, NO_CHAIN});
+            }
+        }
+        keep_pareto_arcs(arcs);
+        for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+            edges.push_back(Edge((VertexId)source, arc->target, arc->cost));
+        }
+    }
+    AdjacencyMatrix pruned(graph_size, edges);
+    AdjacencyMatrix inv_pruned(graph_size, edges, true);
+
+    GraphSimplification simplification;
+    std::vector<bool> chain_vertex(graph_size+1, false);
+    for (size_t vertex = 1; vertex <= graph_size; ++vertex) {
+        chain_vertex[vertex] = is_chain_vertex(pruned, inv_pruned, vertex);
+    }
+    for (auto vertex = kept_vertices.begin(); vertex != kept_vertices.end(); ++vertex) {
+        chain_vertex.at(*vertex) = false;
+    }
+
+    // Every chain is walked from the non chain vertex it starts at. Chains that close a cycle on
+    // their own start and rings made only of chain vertices never reach a non chain vertex and are dropped.
+    std::vector<GraphSimplification::ChainArc> chains;
+    edges.clear();
+    for (size_t source = 0; source <= graph_size; ++source) {
+        if (chain_vertex[source]) {
+            simplification.contracted++;
+            continue;
+        }
+
+        arcs.clear();
+        chains.clear();
+        AdjacencyMatrix::Neighbors out_edges = pruned[source];
+        for (auto p_edge = out_edges.begin(); p_edge != out_edges.end(); ++p_edge) {
+            if (chain_vertex[p_edge->target] == false) {
+                arcs.push_back({p_edge->target, p_edge->cost, NO_CHAIN});
+                continue;
+            }
+
+            GraphSimplification::ChainArc chain = {(VertexId)source, 0, p_edge->cost,
+                                                   simplification.chain_vertices.size(), 0};
+            size_t previous = source;
+            size_t current = p_edge->target;
+            while (chain_vertex[current]) {
+                simplification.chain_vertices.push_back((VertexId)current);
+                simplification.chain_costs.push_back(chain.cost);
+
+                // Continue to the neighbour we did not come from
+                AdjacencyMatrix::Neighbors next_edges = pruned[current];
+                auto p_next = next_edges.begin();
+                if (p_next->target == previous) {
+                    ++p_next;
+                }
+                chain.cost[0] += p_next->cost[0];
+                chain.cost[1] += p_next->cost[1];
+                previous = current;
+                current = p_next->target;
+            }
+
+            if (current == source) {
+                simplification.chain_vertices.resize(chain.first_vertex);
+                simplification.chain_costs.resize(chain.first_vertex);
+                continue;
+            }
+            chain.target = (VertexId)current;
+            chain.last_vertex = simplification.chain_vertices.size();
+            arcs.push_back({chain.target, chain.cost, chains.size()});
+            chains.push_back(chain);
+        }
+
+        // Chains also create parallel arcs (e.g. the two sides of a ring road), filter once more
+        keep_pareto_arcs(arcs);
+        for (auto arc = arcs.begin(); arc != arcs.end(); ++arc) {
+            edges.push_back(Edge((VertexId)source, arc->target, arc->cost));
+            if (arc->chain != NO_CHAIN) {
+                simplification.chain_arcs.push_back(chains[arc->chain]);
+            }
+        }
+    }
+
+    graph = AdjacencyMatrix(graph_size, edges);
+    inv_graph = AdjacencyMatrix(graph_size, edges, true);
+    simplification.removed_arcs = original_edges - graph.edges_count();
+    return simplification;
+}
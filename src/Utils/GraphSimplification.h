@@ -0,0 +1,52 @@
+#ifndef UTILS_GRAPH_SIMPLIFICATION_H
+#define UTILS_GRAPH_SIMPLIFICATION_H
+
+#include <vector>
+#include "Definitions.h"
+
+// Record of the chains contracted by simplify_graphs(). Searches run on the simplified graph,
+// where a chain of degree 2 vertices is a single arc, and solutions are expanded back to the
+// full vertex path at the boundary (see VertexOrdering for the analogous relabeling).
+class GraphSimplification {
+private:
+    struct ChainArc {
+        VertexId    source;
+        VertexId    target;
+        Pair<Cost>  cost;
+        size_t      first_vertex;   // Interior vertices are chain_vertices[first_vertex, last_vertex)
+        size_t      last_vertex;
+    };
+
+    std::vector<ChainArc>   chain_arcs;         // Sorted by source, target and cost
+    std::vector<VertexId>   chain_vertices;     // Interior vertices of the chains, in path order
+    std::vector<Pair<Cost>> chain_costs;        // Cost from the chain source to each interior vertex
+    size_t                  contracted = 0;
+    size_t                  removed_arcs = 0;
+
+    const ChainArc *find_chain(size_t source, size_t target, Pair<Cost> cost) const;
+
+public:
+    GraphSimplification() = default;
+
+    size_t contracted_vertices(void) const;
+    size_t removed_edges(void) const;
+
+    // Copies a solution path of the simplified graph, with the interior vertices of every chain arc restored
+    NodePtr expand(const NodePtr &solution) const;
+    SolutionSet expand(const SolutionSet &solutions) const;
+
+    friend GraphSimplification simplify_graphs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph,
+                                               const std::vector<size_t> &kept_vertices);
+};
+
+// Replaces a graph and its reverse with a simplified pair that has the same Pareto optimal paths
+// between the remaining vertices:
+//  - parallel arcs whose costs are weakly dominated by another arc between the same vertices,
+//    and self loops, are dropped
+//  - chains of degree 2 vertices (two way u<->v<->w or one way u->v->w) are contracted into
+//    arcs with the summed costs, the interior vertices are left without edges
+// `kept_vertices` (typically the query endpoints) are never contracted, so they can still be searched from and to.
+GraphSimplification simplify_graphs(AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph,
+                                    const std::vector<size_t> &kept_vertices);
+
+#endif //UTILS_GRAPH_SIMPLIFICATION_H
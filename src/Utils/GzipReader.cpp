@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstdio>
+#include <zlib.h>
+
+#include "GzipReader.h"
+
+const size_t GZIP_BLOCK_SIZE = 4 << 20;
+const size_t GZIP_MAX_QUEUED_BLOCKS = 4;
+
+
+bool is_gzip_file(const std::string &filename) {
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    unsigned char magic[2] = {0, 0};
+    size_t read = fread(magic, 1, 2, file);
+    fclose(file);
+    return (read == 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b);
+}
+
+
+GzipLineReader::~GzipLineReader() {
+    this->close();
+}
+
+
+bool GzipLineReader::open(const std::string &filename) {
+    this->close();
+
+    gzFile gz_file = gzopen(filename.c_str(), "rb");
+    if (gz_file == nullptr) {
+        return false;
+    }
+    gzbuffer(gz_file, 1 << 20);
+
+    this->finished = false;
+    this->error = false;
+    this->stopping = false;
+    this->decompressor = std::thread(&GzipLineReader::decompress, this, (void *)gz_file);
+    return true;
+}
+
+
+void GzipLineReader::close() {
+    if (this->decompressor.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->block_consumed.notify_all();
+        this->decompressor.join();
+    }
+    this->blocks.clear();
+    this->current_block.clear();
+}
+
+
+void GzipLineReader::decompress(void *gz_handle) {
+    gzFile gz_file = (gzFile)gz_handle;
+    std::vector<char> carry; // Partial last line of the previous block
+    bool success = true;
+
+    while (true) {
+        std::vector<char> block(carry);
+        block.resize(carry.size() + GZIP_BLOCK_SIZE);
+        int read = gzread(gz_file, block.data() + carry.size(), (unsigned)GZIP_BLOCK_SIZE);
+        if (read < 0) {
+            success = false;
+            break;
+        }
+        block.resize(carry.size() + (size_t)read);
+        carry.clear();
+
+        bool end_of_file = (read == 0);
+        if (end_of_file == false) {
+            // Blocks end on a line boundary, the partial line moves on to the next block
+            auto last_newline = std::find(block.rbegin(), block.rend(), '\n');
+            if (last_newline != block.rend()) {
+                carry.assign(last_newline.base(), block.end());
+                block.erase(last_newline.base(), block.end());
+            } else {
+                carry.swap(block);
+                continue;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->block_consumed.wait(lock, [this]() {
+            return this->stopping || (this->blocks.size() < GZIP_MAX_QUEUED_BLOCKS);
+        });
+        if (this->stopping) {
+            break;
+        }
+        if (block.empty() == false) {
+            this->blocks.push_back(std::move(block));
+        }
+        lock.unlock();
+        this->block_ready.notify_one();
+        if (end_of_file) {
+            break;
+        }
+    }
+
+    // gzread stops quietly at a truncated stream, the trailer check reports it
+    int error_code;
+    gzerror(gz_file, &error_code);
+    success = success && (error_code == Z_OK || error_code == Z_STREAM_END) && gzeof(gz_file);
+    gzclose(gz_file);
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished = true;
+        this->error = (success == false) && (this->stopping == false);
+    }
+    this->block_ready.notify_all();
+}
+
+
+bool GzipLineReader::next_block(const char *&begin, const char *&end) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->block_ready.wait(lock, [this]() {return this->finished || (this->blocks.empty() == false);});
+    if (this->blocks.empty() || this->error) {
+        return false;
+    }
+
+    this->current_block.swap(this->blocks.front());
+    this->blocks.pop_front();
+    lock.unlock();
+    this->block_consumed.notify_one();
+
+    begin = this->current_block.data();
+    end = begin + this->current_block.size();
+    return true;
+}
+
+
+bool GzipLineReader::failed() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->error;
+}
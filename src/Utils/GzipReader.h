@@ -0,0 +1,47 @@
+#ifndef UTILS_GZIP_READER_H
+#define UTILS_GZIP_READER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// True if the file starts with the gzip magic bytes
+bool is_gzip_file(const std::string &filename);
+
+
+// Decompresses a gzip file on a background thread and hands out its content as blocks of whole
+// lines, so the caller parses one block while the next ones are being decompressed.
+// At most a few blocks are buffered, the memory use does not depend on the file size.
+class GzipLineReader {
+private:
+    std::thread                         decompressor;
+    std::mutex                          mutex;
+    std::condition_variable             block_ready;
+    std::condition_variable             block_consumed;
+    std::deque<std::vector<char>>       blocks;
+    std::vector<char>                   current_block;
+    bool                                finished = false;
+    bool                                error = false;
+    bool                                stopping = false;
+
+    void decompress(void *gz_file);
+
+public:
+    GzipLineReader() = default;
+    GzipLineReader(const GzipLineReader &) = delete;
+    GzipLineReader& operator=(const GzipLineReader &) = delete;
+    ~GzipLineReader();
+
+    bool open(const std::string &filename);
+    void close(void);
+    // Sets [begin, end) to the next block, valid until the following call.
+    // Returns false once the whole file was read or on a decompression error (see failed).
+    bool next_block(const char *&begin, const char *&end);
+    // True if the file is corrupted or truncated
+    bool failed(void);
+};
+
+#endif //UTILS_GZIP_READER_H
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+
+#include "HugePages.h"
+
+namespace {
+
+enum class Backing {HUGETLB, ADVISED, REGULAR, HEAP};
+
+std::atomic<bool>           enabled(true);
+
+// Large allocations are few, a locked registry of their backing is cheap enough
+struct Registry {
+    std::mutex                  mutex;
+    std::map<void *, Backing>   backings;
+    size_t                      backing_bytes[4] = {0, 0, 0, 0};
+};
+
+// Never destroyed: arrays owned by globals of other translation units (map registry, heuristic cache)
+// are released during static destruction, possibly after the statics of this file
+Registry &registry(void) {
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+
+size_t round_up(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+
+// Maps `size` bytes aligned to HUGE_PAGE_SIZE (the alignment that lets the kernel back them with
+// transparent huge pages) by over allocating and trimming
+void *map_aligned(size_t size) {
+    void *mapping = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    uintptr_t begin = (uintptr_t)mapping;
+    uintptr_t aligned = round_up(begin, HUGE_PAGE_SIZE);
+    if (aligned != begin) {
+        munmap(mapping, aligned - begin);
+    }
+    munmap((void *)(aligned + size), begin + HUGE_PAGE_SIZE - aligned);
+    return (void *)aligned;
+}
+
+} // namespace
+
+
+void set_huge_pages_enabled(bool enable) {enabled = enable;}
+
+
+bool huge_pages_enabled(void) {return enabled;}
+
+
+HugePageStats huge_page_stats(void) {
+    HugePageStats stats;
+    {
+        Registry &allocations = registry();
+        std::lock_guard<std::mutex> lock(allocations.mutex);
+        stats = {allocations.backing_bytes[(int)Backing::HUGETLB], allocations.backing_bytes[(int)Backing::ADVISED],
+                 allocations.backing_bytes[(int)Backing::REGULAR], allocations.backing_bytes[(int)Backing::HEAP], 0};
+    }
+
+    FILE *smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (smaps != nullptr) {
+        char line[256];
+        while (fgets(line, sizeof(line), smaps) != nullptr) {
+            size_t kilobytes;
+            if (sscanf(line, "AnonHugePages: %zu kB", &kilobytes) == 1) {
+                stats.transparent_bytes = kilobytes << 10;
+            }
+        }
+        fclose(smaps);
+    }
+    return stats;
+}
+
+
+void *allocate_large(size_t bytes) {
+    if (bytes < HUGE_PAGE_SIZE) {
+        return ::operator new(bytes);
+    }
+
+    size_t mapping_size = round_up(bytes, HUGE_PAGE_SIZE);
+    Backing backing = Backing::HUGETLB;
+    void *mapping = MAP_FAILED;
+    if (enabled) {
+        // Fails unless huge pages were reserved (vm.nr_hugepages)
+        mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        mapping = map_aligned(mapping_size);
+        if (mapping != nullptr) {
+            // The system policy may be "always", so disabling has to be explicit for a fair comparison
+            backing = enabled ? Backing::ADVISED : Backing::REGULAR;
+            madvise(mapping, mapping_size, enabled ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+        } else {
+            // Out of mappings (vm.max_map_count) or address space, the heap may still serve it
+            backing = Backing::HEAP;
+            mapping = ::operator new(bytes);
+        }
+    }
+
+    Registry &allocations = registry();
+    std::lock_guard<std::mutex> lock(allocations.mutex);
+    allocations.backings[mapping] = backing;
+    allocations.backing_bytes[(int)backing] += mapping_size;
+    return mapping;
+}
+
+
+void deallocate_large(void *pointer, size_t bytes) {
+    if (bytes < HUGE_PAGE_SIZE) {
+        ::operator delete(pointer);
+        return;
+    }
+
+    size_t mapping_size = round_up(bytes, HUGE_PAGE_SIZE);
+    Backing backing;
+    {
+        Registry &allocations = registry();
+        std::lock_guard<std::mutex> lock(allocations.mutex);
+        auto entry = allocations.backings.find(pointer);
+        if (entry == allocations.backings.end()) {
+            // Not from allocate_large() or already released, going on would leak or corrupt memory
+            fprintf(stderr, "deallocate_large: %p of %zu bytes was not allocated by allocate_large\n", pointer, bytes);
+            abort();
+        }
+        backing = entry->second;
+        allocations.backing_bytes[(int)backing] -= mapping_size;
+        allocations.backings.erase(entry);
+    }
+    if (backing == Backing::HEAP) {
+        ::operator delete(pointer);
+    } else {
+        munmap(pointer, mapping_size);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef UTILS_HUGE_PAGES_H
+#define UTILS_HUGE_PAGES_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Allocation layer for the large per vertex arrays that the searches access at random (graph
+// columns, heuristic tables, min_g2), where 4 KB pages thrash the TLB on large maps.
+// Arrays of at least HUGE_PAGE_SIZE bytes are mapped directly, 2 MB aligned, and backed by huge
+// pages when enabled: explicit MAP_HUGETLB pages first, falling back to transparent huge pages
+// (madvise). Smaller arrays use the regular heap, as do large ones when mapping them fails.
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+struct HugePageStats {
+    size_t  hugetlb_bytes;      // Mapped with explicit huge pages
+    size_t  advised_bytes;      // Mapped with MADV_HUGEPAGE, backed by huge pages as the kernel manages
+    size_t  regular_bytes;      // Mapped while huge pages were disabled
+    size_t  heap_bytes;         // On the regular heap, mapping them failed
+    size_t  transparent_bytes;  // Anonymous memory of the process currently backed by transparent huge pages
+};
+
+// Huge pages are enabled by default. The switch applies to the allocations made after it.
+void set_huge_pages_enabled(bool enabled);
+bool huge_pages_enabled(void);
+// Live large allocations per backing, plus the kernel's count of transparent huge pages
+HugePageStats huge_page_stats(void);
+
+void *allocate_large(size_t bytes);
+// Aborts on a large pointer that allocate_large() did not return, or that was already released
+void deallocate_large(void *pointer, size_t bytes);
+
+
+template<typename T>
+class HugePageAllocator {
+public:
+    typedef T value_type;
+
+    HugePageAllocator() = default;
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(allocate_large(n * sizeof(T)));
+    }
+    void deallocate(T *pointer, size_t n) {
+        deallocate_large(pointer, n * sizeof(T));
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const HugePageAllocator<T> &, const HugePageAllocator<U> &) {return true;}
+template<typename T, typename U>
+bool operator!=(const HugePageAllocator<T> &, const HugePageAllocator<U> &) {return false;}
+
+template<typename T>
+using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+#endif //UTILS_HUGE_PAGES_H
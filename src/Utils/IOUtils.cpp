@@ -2,7 +2,15 @@
 #include <vector>
 #include <fstream>
 #include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <numeric>
+#include <functional>
 #include "IOUtils.h"
+#include "MappedFile.h"
+#include "GzipReader.h"
+#include "HugePages.h"
 
 void split_string(std::string string, std::string delimiter, std::vector<std::string> &results)
 {
@@ -21,52 +29,484 @@ void split_string(std::string string, std::string delimiter, std::vector<std::st
 }
 
 
+// Arc as read from a single .gr file, before it is paired with the same arc of the second file
+struct GrArc {
+    size_t  source;
+    size_t  target;
+    size_t  cost;
+};
+
+enum class GrLineType {ARC, SKIPPED, MALFORMED};
+
+
+// Parses an unsigned decimal number at `pos` (skipping leading blanks) and advances `pos` past it.
+// Works directly on the mapped file, so no token is ever copied or allocated.
+bool parse_number(const char *&pos, const char *end, size_t &value) {
+    while ((pos != end) && ((*pos == ' ') || (*pos == '\t'))) {
+        ++pos;
+    }
+    if ((pos == end) || (*pos < '0') || (*pos > '9')) {
+        return false;
+    }
+
+    value = 0;
+    while ((pos != end) && (*pos >= '0') && (*pos <= '9')) {
+        if (value > (SIZE_MAX - 9)/10) {
+            return false;   // Would wrap size_t, and so slip past the width checks of the callers
+        }
+        value = value*10 + (size_t)(*pos - '0');
+        ++pos;
+    }
+    return true;
+}
+
+
+// Parses the .gr line [line, line_end) (without the newline). Comment, problem and empty lines are
+// not part of the graph and are skipped.
+GrLineType parse_gr_line(const char *line, const char *line_end, GrArc &arc) {
+    if ((line == line_end) || (*line == 'c') || (*line == 'p') || (*line == '\r')) {
+        return GrLineType::SKIPPED;
+    }
+    if (*line != 'a') {
+        return GrLineType::MALFORMED;
+    }
+
+    const char *pos = line + 1;
+    if ((parse_number(pos, line_end, arc.source) == false) ||
+        (parse_number(pos, line_end, arc.target) == false) ||
+        (parse_number(pos, line_end, arc.cost) == false)) {
+        return GrLineType::MALFORMED;
+    }
+    if ((arc.source > MAX_VERTEX_ID) || (arc.target > MAX_VERTEX_ID) || (arc.cost >= MAX_COST)) {
+        return GrLineType::MALFORMED; // Does not fit the VertexId / Cost widths of this build
+    }
+    return GrLineType::ARC;
+}
+
+
+// Parses all the arcs in [begin, end), which must start at a line boundary
+bool parse_gr_chunk(const char *begin, const char *end, std::vector<GrArc> &arcs_out) {
+    GrArc arc;
+    while (begin < end) {
+        const char *line_end = std::find(begin, end, '\n');
+        GrLineType type = parse_gr_line(begin, line_end, arc);
+        if (type == GrLineType::MALFORMED) {
+            return false;
+        } else if (type == GrLineType::ARC) {
+            arcs_out.push_back(arc);
+        }
+        begin = line_end + 1;
+    }
+    return true;
+}
+
+
+size_t parser_threads_count(void) {
+    size_t threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+
+// Splits a mapped file into up to `chunks_count` ranges that start and end on line boundaries
+std::vector<const char *> split_on_lines(const MappedFile &file, size_t chunks_count) {
+    const size_t MIN_CHUNK_SIZE = 1 << 20;
+    chunks_count = std::max<size_t>(1, std::min(chunks_count, file.size() / MIN_CHUNK_SIZE));
+
+    std::vector<const char *> boundaries = {file.begin()};
+    for (size_t i = 1; i < chunks_count; ++i) {
+        const char *boundary = std::max(file.begin() + i*(file.size()/chunks_count), boundaries.back());
+        boundary = std::find(boundary, file.end(), '\n');
+        boundaries.push_back(boundary == file.end() ? boundary : boundary + 1);
+    }
+    boundaries.push_back(file.end());
+    return boundaries;
+}
+
+
+// A text input file read as a sequence of blocks of whole lines: the whole memory mapping of a
+// plain file, or the blocks of a gzip file as they are decompressed (see GzipLineReader)
+class TextInput {
+private:
+    MappedFile                      mapped;
+    bool                            mapped_consumed = false;
+    std::unique_ptr<GzipLineReader> gzip;
+
+public:
+    bool open(const std::string &filename) {
+        this->mapped.close();
+        this->gzip.reset();
+        if (is_gzip_file(filename)) {
+            this->gzip.reset(new GzipLineReader());
+            return this->gzip->open(filename);
+        }
+        this->mapped_consumed = false;
+        return this->mapped.open(filename);
+    }
+
+    // The mapping of a plain file, nullptr for a compressed file that is only available as a stream
+    const MappedFile *mapped_file(void) const {
+        return (this->gzip == nullptr) ? &this->mapped : nullptr;
+    }
+
+    bool next_block(const char *&begin, const char *&end) {
+        if (this->gzip != nullptr) {
+            return this->gzip->next_block(begin, end);
+        }
+        if (this->mapped_consumed) {
+            return false;
+        }
+        this->mapped_consumed = true;
+        begin = this->mapped.begin();
+        end = this->mapped.end();
+        return true;
+    }
+
+    bool failed(void) {
+        return (this->gzip != nullptr) && this->gzip->failed();
+    }
+};
+
+
 bool load_gr_files(std::string gr_file1, std::string gr_file2, std::vector<Edge> &edges_out, size_t &graph_size) {
-    size_t          max_node_num = 0;
-    std::ifstream   file1(gr_file1.c_str());
-    std::ifstream   file2(gr_file2.c_str());
+    TextInput input1, input2;
+    if ((input1.open(gr_file1) == false) || (input2.open(gr_file2) == false)) {
+        return false;
+    }
 
-    if ((file1.is_open() == false) || (file2.is_open() == false)) {
+    // Parse the chunks of both files concurrently, each chunk into its own arcs vector.
+    // A compressed file is a single chunk, parsed block by block as it is decompressed.
+    const MappedFile *file1 = input1.mapped_file();
+    const MappedFile *file2 = input2.mapped_file();
+    std::vector<const char *> boundaries1 = file1 ? split_on_lines(*file1, parser_threads_count()) :
+                                                    std::vector<const char *>(2, nullptr);
+    std::vector<const char *> boundaries2 = file2 ? split_on_lines(*file2, parser_threads_count()) :
+                                                    std::vector<const char *>(2, nullptr);
+    size_t chunks1 = boundaries1.size() - 1;
+    size_t chunks2 = boundaries2.size() - 1;
+
+    std::vector<std::vector<GrArc>> chunk_arcs(chunks1 + chunks2);
+    std::vector<char> chunk_valid(chunks1 + chunks2, true);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunks1 + chunks2; ++i) {
+        const std::vector<const char *> &boundaries = (i < chunks1) ? boundaries1 : boundaries2;
+        TextInput *input = (i < chunks1) ? &input1 : &input2;
+        size_t chunk = (i < chunks1) ? i : i - chunks1;
+        workers.push_back(std::thread([&chunk_arcs, &chunk_valid, &boundaries, input, chunk, i]() {
+            if (input->mapped_file() != nullptr) {
+                chunk_valid[i] = parse_gr_chunk(boundaries[chunk], boundaries[chunk+1], chunk_arcs[i]);
+                return;
+            }
+            const char *begin, *end;
+            while (input->next_block(begin, end)) {
+                if (parse_gr_chunk(begin, end, chunk_arcs[i]) == false) {
+                    chunk_valid[i] = false;
+                    return;
+                }
+            }
+            chunk_valid[i] = (input->failed() == false);
+        }));
+    }
+    for (auto worker = workers.begin(); worker != workers.end(); ++worker) {
+        worker->join();
+    }
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), false) != chunk_valid.end()) {
         return false;
     }
 
-    std::string line1, line2;
-    while ((file1.eof() == false) && (file2.eof() == false)) {
-        std::getline(file1, line1);
-        std::getline(file2, line2);
+    // Flatten the arcs of the second file, so the i'th arc of both files can be addressed directly
+    std::vector<GrArc> arcs2;
+    for (size_t i = chunks1; i < chunks1 + chunks2; ++i) {
+        arcs2.insert(arcs2.end(), chunk_arcs[i].begin(), chunk_arcs[i].end());
+        std::vector<GrArc>().swap(chunk_arcs[i]);
+    }
 
-        if ((line1 == "") || (line2 == "")) {
-            break;
+    size_t arcs_count = 0;
+    std::vector<size_t> chunk_first_arc(chunks1);
+    for (size_t i = 0; i < chunks1; ++i) {
+        chunk_first_arc[i] = arcs_count;
+        arcs_count += chunk_arcs[i].size();
+    }
+    if (arcs_count != arcs2.size()) {
+        return false;
+    }
+
+    // Pair the arcs of both files, again one thread per chunk of the first file.
+    // src and dest of each arc should be the same in both files.
+    size_t first_edge = edges_out.size();
+    edges_out.resize(first_edge + arcs_count);
+    std::vector<size_t> chunk_max_node(chunks1, 0);
+    workers.clear();
+    for (size_t i = 0; i < chunks1; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            const std::vector<GrArc> &arcs1 = chunk_arcs[i];
+            for (size_t j = 0; j < arcs1.size(); ++j) {
+                const GrArc &arc1 = arcs1[j];
+                const GrArc &arc2 = arcs2[chunk_first_arc[i] + j];
+                if ((arc1.source != arc2.source) || (arc1.target != arc2.target)) {
+                    chunk_valid[i] = false;
+                    return;
+                }
+                edges_out[first_edge + chunk_first_arc[i] + j] =
+                    Edge((VertexId)arc1.source, (VertexId)arc1.target, {(Cost)arc1.cost, (Cost)arc2.cost});
+                chunk_max_node[i] = std::max({chunk_max_node[i], arc1.source, arc1.target});
+            }
+        }));
+    }
+    for (auto worker = workers.begin(); worker != workers.end(); ++worker) {
+        worker->join();
+    }
+    if (std::find(chunk_valid.begin(), chunk_valid.begin()+chunks1, false) != chunk_valid.begin()+chunks1) {
+        edges_out.resize(first_edge);
+        return false;
+    }
+
+    graph_size = *std::max_element(chunk_max_node.begin(), chunk_max_node.end());
+    return true;
+}
+
+// Reads the problem line ("p sp <vertices> <arcs>") among the lines of a .gr file before its first arc,
+// zeros when there is none
+void parse_gr_problem_line(const char *pos, const char *end, size_t &vertices, size_t &arcs) {
+    vertices = 0;
+    arcs = 0;
+    while ((pos < end) && ((*pos == 'c') || (*pos == 'p'))) {
+        const char *line_end = std::find(pos, end, '\n');
+        if ((*pos == 'p') && (line_end - pos > 4) && (std::string(pos, 5) == "p sp ")) {
+            const char *number = pos + 4;
+            if ((parse_number(number, line_end, vertices) == false) ||
+                (parse_number(number, line_end, arcs) == false)) {
+                vertices = 0;
+                arcs = 0;
+            }
         }
+        pos = line_end + 1;
+    }
+}
+
+
+// Counts the arc lines in [begin, end) without parsing them, malformed ones are found when they are parsed
+size_t count_gr_arcs(const char *begin, const char *end) {
+    size_t arcs = 0;
+    while (begin < end) {
+        arcs += (*begin == 'a') ? 1 : 0;
+        begin = std::find(begin, end, '\n') + 1;
+    }
+    return arcs;
+}
 
-        std::vector<std::string> decomposed_line1, decomposed_line2;
-        split_string(line1, " ", decomposed_line1);
-        split_string(line2, " ", decomposed_line2);
 
-        std::string type = decomposed_line1[0];
-        if ((std::strcmp(type.c_str(),"c") == 0) || (std::strcmp(type.c_str(),"p") == 0)) {
-            continue; //comment or problem lines, not part of the graph
+// Returns the start of the arc line that follows the first `arcs` arc lines of [begin, end)
+const char *skip_gr_arcs(const char *begin, const char *end, size_t arcs) {
+    while (begin < end) {
+        if (*begin == 'a') {
+            if (arcs == 0) {
+                return begin;
+            }
+            --arcs;
         }
+        begin = std::find(begin, end, '\n') + 1;
+    }
+    return end;
+}
+
+
+// Runs task(0), ..., task(count-1) on a thread each
+void run_concurrently(size_t count, const std::function<void(size_t)> &task) {
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < count; ++i) {
+        workers.push_back(std::thread(task, i));
+    }
+    for (auto worker = workers.begin(); worker != workers.end(); ++worker) {
+        worker->join();
+    }
+}
+
+
+// Walks the same arcs of two .gr files in lockstep, pairing the costs of each arc
+class GrPairReader {
+private:
+    const char  *pos1;
+    const char  *end1;
+    const char  *pos2;
+    const char  *end2;
+
+    // Returns ARC and fills `arc` with the next arc of the range, SKIPPED at its end, MALFORMED on error
+    static GrLineType next_arc(const char *&pos, const char *end, GrArc &arc) {
+        while (pos < end) {
+            const char *line_end = std::find(pos, end, '\n');
+            GrLineType type = parse_gr_line(pos, line_end, arc);
+            pos = line_end + 1;
+            if (type != GrLineType::SKIPPED) {
+                return type;
+            }
+        }
+        return GrLineType::SKIPPED;
+    }
+
+public:
+    GrPairReader(const char *begin1, const char *end1, const char *begin2, const char *end2)
+        : pos1(begin1), end1(end1), pos2(begin2), end2(end2) {}
+
+    // Returns ARC with the next arc of both ranges, SKIPPED when both ended and
+    // MALFORMED on a parsing error or when the files do not describe the same arcs
+    GrLineType next(size_t &source, size_t &target, Pair<Cost> &cost) {
+        GrArc arc1 = {}, arc2 = {};
+        GrLineType type1 = next_arc(this->pos1, this->end1, arc1);
+        GrLineType type2 = next_arc(this->pos2, this->end2, arc2);
+        if (type1 != type2) {
+            return GrLineType::MALFORMED;
+        } else if (type1 != GrLineType::ARC) {
+            return type1;
+        } else if ((arc1.source != arc2.source) || (arc1.target != arc2.target)) {
+            return GrLineType::MALFORMED;
+        }
+
+        source = arc1.source;
+        target = arc1.target;
+        cost = {(Cost)arc1.cost, (Cost)arc2.cost};
+        return GrLineType::ARC;
+    }
+};
+
 
-        if ((decomposed_line1[0] != decomposed_line2[0]) ||
-            (decomposed_line1[1] != decomposed_line2[1]) ||
-            (decomposed_line1[2] != decomposed_line2[2])) {
-            // arc_sign src dest should be same in both files
+bool load_gr_graphs(std::string gr_file1, std::string gr_file2, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph) {
+    if (is_gzip_file(gr_file1) || is_gzip_file(gr_file2)) {
+        // A second pass would decompress the files again, which costs more than materialising the
+        // arcs once (an arc takes less memory than its two text lines)
+        std::vector<Edge> edges;
+        size_t graph_size;
+        if (load_gr_files(gr_file1, gr_file2, edges, graph_size) == false) {
             return false;
         }
+        graph = AdjacencyMatrix(graph_size, edges);
+        inv_graph = AdjacencyMatrix(graph_size, edges, true);
+        return path_costs_fit(graph, inv_graph);
+    }
+
+    MappedFile file1, file2;
+    if ((file1.open(gr_file1) == false) || (file2.open(gr_file2) == false)) {
+        return false;
+    }
+    size_t problem_vertices, problem_arcs;
+    parse_gr_problem_line(file1.begin(), file1.end(), problem_vertices, problem_arcs);
+
+    // Every chunk keeps 32 bit degree counts of its own per direction, the chunks are limited so that
+    // the counts take at most half the memory of the graphs
+    size_t max_chunks = (problem_vertices == 0) ? parser_threads_count() :
+        std::max<size_t>(1, problem_arcs*(sizeof(VertexId) + 2*sizeof(Cost)) / (2*sizeof(uint32_t)*problem_vertices));
+    std::vector<const char *> boundaries1 = split_on_lines(file1, std::min(parser_threads_count(), max_chunks));
+    std::vector<const char *> split2 = split_on_lines(file2, boundaries1.size() - 1);
+    size_t chunks = boundaries1.size() - 1;
+    size_t split_chunks = split2.size() - 1;
 
-        if (std::strcmp(type.c_str(),"a") == 0) { //arc
-            Edge e(std::stoul(decomposed_line1[1]),
-                   std::stoul(decomposed_line1[2]),
-                   {std::stoul(decomposed_line1[3]), std::stoul(decomposed_line2[3])});
-            edges_out.push_back(e);
-            max_node_num = std::max({max_node_num, e.source, e.target});
+    // Count the arcs of every chunk of both files, so the chunks of the second file can be moved to
+    // start at the same arcs as the chunks of the first
+    std::vector<size_t> first_arc1(chunks+1, 0);
+    std::vector<size_t> first_arc2(split_chunks+1, 0);
+    run_concurrently(chunks + split_chunks, [&](size_t i) {
+        if (i < chunks) {
+            first_arc1[i+1] = count_gr_arcs(boundaries1[i], boundaries1[i+1]);
+        } else {
+            first_arc2[i-chunks+1] = count_gr_arcs(split2[i-chunks], split2[i-chunks+1]);
         }
+    });
+    std::partial_sum(first_arc1.begin(), first_arc1.end(), first_arc1.begin());
+    std::partial_sum(first_arc2.begin(), first_arc2.end(), first_arc2.begin());
+    size_t arcs_count = first_arc1.back();
+    if ((arcs_count != first_arc2.back()) || ((problem_arcs != 0) && (problem_arcs != arcs_count))) {
+        return false; // Files differ, are corrupted or truncated
     }
-    graph_size = max_node_num;
-    return true;
+
+    std::vector<const char *> boundaries2(chunks+1, file2.end());
+    boundaries2[0] = file2.begin();
+    run_concurrently(chunks - 1, [&](size_t i) {
+        size_t arc = first_arc1[i+1];
+        size_t split_chunk = std::upper_bound(first_arc2.begin(), first_arc2.end(), arc) - first_arc2.begin() - 1;
+        boundaries2[i+1] = skip_gr_arcs(split2[split_chunk], split2[split_chunk+1], arc - first_arc2[split_chunk]);
+    });
+
+    // First pass - every chunk counts the degrees of its arcs
+    std::vector<HugePageVector<uint32_t>> forward_counts(chunks);
+    std::vector<HugePageVector<uint32_t>> reverse_counts(chunks);
+    std::vector<size_t> chunk_max_node(chunks, 0);
+    std::vector<char> chunk_valid(chunks, true);
+    run_concurrently(chunks, [&](size_t chunk) {
+        HugePageVector<uint32_t> &forward_count = forward_counts[chunk];
+        HugePageVector<uint32_t> &reverse_count = reverse_counts[chunk];
+        forward_count.assign(problem_vertices+1, 0);
+        reverse_count.assign(problem_vertices+1, 0);
+
+        size_t source, target;
+        Pair<Cost> cost;
+        GrLineType status;
+        GrPairReader reader(boundaries1[chunk], boundaries1[chunk+1], boundaries2[chunk], boundaries2[chunk+1]);
+        while ((status = reader.next(source, target, cost)) == GrLineType::ARC) {
+            size_t max_node = std::max(source, target);
+            if (max_node >= forward_count.size()) {
+                forward_count.resize(max_node+1, 0);
+                reverse_count.resize(max_node+1, 0);
+            }
+            forward_count[source]++;
+            reverse_count[target]++;
+            chunk_max_node[chunk] = std::max(chunk_max_node[chunk], max_node);
+        }
+        chunk_valid[chunk] = (status != GrLineType::MALFORMED);
+    });
+    if (std::find(chunk_valid.begin(), chunk_valid.end(), false) != chunk_valid.end()) {
+        return false;
+    }
+
+    // Per vertex, the counts of the chunks are summed into its degree and turned into the ranks of the
+    // first arc of every chunk among the arcs of the vertex, so the file order is kept
+    size_t max_node_num = *std::max_element(chunk_max_node.begin(), chunk_max_node.end());
+    AdjacencyMatrixBuilder forward(max_node_num);
+    AdjacencyMatrixBuilder reverse(max_node_num);
+    forward.reserve(max_node_num);
+    reverse.reserve(max_node_num);
+    run_concurrently(chunks, [&](size_t chunk) {
+        forward_counts[chunk].resize(max_node_num+1, 0);
+        reverse_counts[chunk].resize(max_node_num+1, 0);
+    });
+    run_concurrently(chunks, [&](size_t part) {
+        size_t last = (part+1)*(max_node_num+1)/chunks;
+        for (size_t vertex = part*(max_node_num+1)/chunks; vertex < last; ++vertex) {
+            uint32_t out_degree = 0;
+            uint32_t in_degree = 0;
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                uint32_t out_count = forward_counts[chunk][vertex];
+                uint32_t in_count = reverse_counts[chunk][vertex];
+                forward_counts[chunk][vertex] = out_degree;
+                reverse_counts[chunk][vertex] = in_degree;
+                out_degree += out_count;
+                in_degree += in_count;
+            }
+            forward.count_edges(vertex, out_degree);
+            reverse.count_edges(vertex, in_degree);
+        }
+    });
+
+    // Second pass - every chunk scatters its arcs straight into their forward and reverse slots
+    forward.allocate(max_node_num);
+    reverse.allocate(max_node_num);
+    run_concurrently(chunks, [&](size_t chunk) {
+        HugePageVector<uint32_t> &forward_rank = forward_counts[chunk];
+        HugePageVector<uint32_t> &reverse_rank = reverse_counts[chunk];
+
+        size_t source, target;
+        Pair<Cost> cost;
+        GrPairReader reader(boundaries1[chunk], boundaries1[chunk+1], boundaries2[chunk], boundaries2[chunk+1]);
+        while (reader.next(source, target, cost) == GrLineType::ARC) {
+            forward.place_edge(forward.edges_begin(source) + forward_rank[source]++, target, cost);
+            reverse.place_edge(reverse.edges_begin(target) + reverse_rank[target]++, source, cost);
+        }
+    });
+
+    graph = forward.build_placed();
+    inv_graph = reverse.build_placed();
+    return path_costs_fit(graph, inv_graph);
 }
 
+
 bool load_txt_file(std::string txt_file, std::vector<Edge> &edges_out, size_t &graph_size) {
     bool            first_line = true;
     size_t          max_node_num = 0;
@@ -91,17 +531,81 @@ bool load_txt_file(std::string txt_file, std::vector<Edge> &edges_out, size_t &g
             first_line = false;
             continue;
         }
-        Edge e(std::stoul(decomposed_line[0]),
-               std::stoul(decomposed_line[1]),
-               {std::stoul(decomposed_line[2]), std::stoul(decomposed_line[3])});
+        Edge e((VertexId)std::stoul(decomposed_line[0]),
+               (VertexId)std::stoul(decomposed_line[1]),
+               {(Cost)std::stoul(decomposed_line[2]), (Cost)std::stoul(decomposed_line[3])});
         edges_out.push_back(e);
-        max_node_num = std::max({max_node_num, e.source, e.target});
+        max_node_num = std::max({max_node_num, (size_t)e.source, (size_t)e.target});
     }
     graph_size = max_node_num;
     return true;
 }
 
 
+// Parses an optionally negative decimal number, .co coordinates are signed
+bool parse_signed_number(const char *&pos, const char *end, double &value) {
+    while ((pos != end) && ((*pos == ' ') || (*pos == '\t'))) {
+        ++pos;
+    }
+    bool negative = (pos != end) && (*pos == '-');
+    if (negative) {
+        ++pos;
+    }
+
+    size_t magnitude;
+    if (parse_number(pos, end, magnitude) == false) {
+        return false;
+    }
+    value = negative ? -(double)magnitude : (double)magnitude;
+    return true;
+}
+
+
+bool load_co_file(std::string co_file, std::vector<Pair<double>> &coordinates_out) {
+    TextInput input;
+    if (input.open(co_file) == false) {
+        return false;
+    }
+
+    coordinates_out.clear();
+    const char *line, *block_end;
+    while (input.next_block(line, block_end)) {
+        while (line < block_end) {
+            const char *line_end = std::find(line, block_end, '\n');
+            const char *pos = line + 1;
+            if ((line == line_end) || (*line == 'c') || (*line == '\r')) {
+                // Comment or empty line
+            } else if (*line == 'p') {
+                // "p aux sp co <vertices>", the vertices count is the last field
+                const char *count_pos = line_end;
+                while ((count_pos != line) && (*(count_pos-1) != ' ')) {
+                    --count_pos;
+                }
+                size_t vertices;
+                if (parse_number(count_pos, line_end, vertices) == false) {
+                    return false;
+                }
+                coordinates_out.resize(vertices+1, {{0, 0}});
+            } else {
+                size_t id;
+                Pair<double> coordinates;
+                if ((*line != 'v') || (parse_number(pos, line_end, id) == false) ||
+                    (parse_signed_number(pos, line_end, coordinates[0]) == false) ||
+                    (parse_signed_number(pos, line_end, coordinates[1]) == false)) {
+                    return false;
+                }
+                if (id >= coordinates_out.size()) {
+                    coordinates_out.resize(id+1, {{0, 0}});
+                }
+                coordinates_out[id] = coordinates;
+            }
+            line = line_end + 1;
+        }
+    }
+    return input.failed() == false;
+}
+
+
 bool load_queries(std::string query_file, std::vector<std::pair<size_t, size_t>> &queries_out) {
     std::ifstream   file(query_file.c_str());
 
@@ -126,4 +630,165 @@ bool load_queries(std::string query_file, std::vector<std::pair<size_t, size_t>>
         queries_out.push_back(query);
     }
     return true;
+}
+
+
+// Snapshot layout: the header below followed by, for the forward and then the reverse graph,
+// the offsets (graph_size+2 size_t values), targets (VertexId values), first costs and second
+// costs (Cost values). Every column is padded to a multiple of 8 bytes so all of them stay aligned.
+// The header records the value widths and byte order, so a snapshot written on an incompatible
+// build (e.g. a different COST_WIDTH) is rejected instead of misread.
+const char      SNAPSHOT_MAGIC[8]   = {'P', 'P', 'G', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t  SNAPSHOT_VERSION    = 2;
+const uint32_t  SNAPSHOT_BYTE_ORDER = 0x01020304;
+const size_t    SNAPSHOT_ALIGNMENT  = 8;
+
+struct GraphSnapshotHeader {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order;
+    uint32_t    offset_size;
+    uint32_t    vertex_id_size;
+    uint32_t    cost_size;
+    uint32_t    reserved;
+    uint64_t    graph_size;
+    uint64_t    forward_edges;
+    uint64_t    reverse_edges;
+    uint64_t    padding;
+};
+
+
+size_t snapshot_column_size(size_t values, size_t value_size) {
+    return ((values*value_size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT) * SNAPSHOT_ALIGNMENT;
+}
+
+
+size_t snapshot_graph_size(size_t graph_size, size_t edges_count) {
+    return snapshot_column_size(graph_size+2, sizeof(size_t)) +
+           snapshot_column_size(edges_count, sizeof(VertexId)) +
+           2*snapshot_column_size(edges_count, sizeof(Cost));
+}
+
+
+void write_snapshot_column(std::ofstream &file, const void *data, size_t values, size_t value_size) {
+    const char padding[SNAPSHOT_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(data), values*value_size);
+    file.write(padding, snapshot_column_size(values, value_size) - values*value_size);
+}
+
+
+void write_snapshot_graph(std::ofstream &file, const AdjacencyMatrix &graph) {
+    write_snapshot_column(file, graph.offsets_data(), graph.size()+2, sizeof(size_t));
+    write_snapshot_column(file, graph.targets_data(), graph.edges_count(), sizeof(VertexId));
+    write_snapshot_column(file, graph.costs_data(0), graph.edges_count(), sizeof(Cost));
+    write_snapshot_column(file, graph.costs_data(1), graph.edges_count(), sizeof(Cost));
+}
+
+
+bool save_graph_snapshot(std::string snapshot_file, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph) {
+    if ((graph.size() != inv_graph.size()) || graph.is_compressed() || inv_graph.is_compressed() ||
+        !graph.is_contiguous() || !inv_graph.is_contiguous()) {
+        return false; // Snapshots hold plain CSR columns only
+    }
+
+    std::ofstream file(snapshot_file.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (file.is_open() == false) {
+        return false;
+    }
+
+    GraphSnapshotHeader header = {};
+    std::copy(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC+sizeof(SNAPSHOT_MAGIC), header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.offset_size = sizeof(size_t);
+    header.vertex_id_size = sizeof(VertexId);
+    header.cost_size = sizeof(Cost);
+    header.graph_size = graph.size();
+    header.forward_edges = graph.edges_count();
+    header.reverse_edges = inv_graph.edges_count();
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write_snapshot_graph(file, graph);
+    write_snapshot_graph(file, inv_graph);
+    return file.good();
+}
+
+
+// Builds a graph over the snapshot columns starting at `data`, returns the number of bytes consumed
+size_t map_snapshot_graph(const char *data, size_t graph_size, size_t edges_count,
+                          std::shared_ptr<const void> storage, AdjacencyMatrix &graph_out) {
+    const char *offsets = data;
+    const char *targets = offsets + snapshot_column_size(graph_size+2, sizeof(size_t));
+    const char *costs1 = targets + snapshot_column_size(edges_count, sizeof(VertexId));
+    const char *costs2 = costs1 + snapshot_column_size(edges_count, sizeof(Cost));
+
+    graph_out = AdjacencyMatrix(graph_size, edges_count,
+                                reinterpret_cast<const size_t *>(offsets),
+                                reinterpret_cast<const VertexId *>(targets),
+                                {{reinterpret_cast<const Cost *>(costs1), reinterpret_cast<const Cost *>(costs2)}},
+                                storage);
+    return snapshot_graph_size(graph_size, edges_count);
+}
+
+
+// Checks the columns of a mapped graph once, so a corrupted file can not send the searches out of bounds:
+// the offsets start at 0, never decrease and end at the edge count, and every target is a vertex
+bool valid_snapshot_graph(const AdjacencyMatrix &graph, size_t edges_count) {
+    const size_t *offsets = graph.offsets_data();
+    if ((offsets[0] != 0) || (offsets[graph.size()+1] != edges_count)) {
+        return false;
+    }
+    for (size_t vertex = 0; vertex <= graph.size(); ++vertex) {
+        if (offsets[vertex] > offsets[vertex+1]) {
+            return false;
+        }
+    }
+
+    const VertexId *targets = graph.targets_data();
+    for (size_t edge = 0; edge < edges_count; ++edge) {
+        if (targets[edge] > graph.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool load_graph_snapshot(std::string snapshot_file, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph) {
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+    if ((mapping->open(snapshot_file) == false) || (mapping->size() < sizeof(GraphSnapshotHeader))) {
+        return false;
+    }
+
+    const GraphSnapshotHeader *header = reinterpret_cast<const GraphSnapshotHeader *>(mapping->begin());
+    if ((std::equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC+sizeof(SNAPSHOT_MAGIC), header->magic) == false) ||
+        (header->version != SNAPSHOT_VERSION) ||
+        (header->byte_order != SNAPSHOT_BYTE_ORDER) ||
+        (header->offset_size != sizeof(size_t)) ||
+        (header->vertex_id_size != sizeof(VertexId)) ||
+        (header->cost_size != sizeof(Cost))) {
+        return false;
+    }
+
+    // Counts the file is too small to hold are rejected first, the column sizes of the others can not overflow
+    size_t graph_size = header->graph_size;
+    size_t max_edges = mapping->size() / (sizeof(VertexId) + 2*sizeof(Cost));
+    if ((graph_size > mapping->size() / sizeof(size_t)) ||
+        (header->forward_edges > max_edges) || (header->reverse_edges > max_edges)) {
+        return false;
+    }
+    size_t expected_size = sizeof(GraphSnapshotHeader) +
+                           snapshot_graph_size(graph_size, header->forward_edges) +
+                           snapshot_graph_size(graph_size, header->reverse_edges);
+    if (mapping->size() != expected_size) {
+        return false; // Truncated or corrupted file
+    }
+
+    const char *data = mapping->begin() + sizeof(GraphSnapshotHeader);
+    data += map_snapshot_graph(data, graph_size, header->forward_edges, mapping, graph);
+    map_snapshot_graph(data, graph_size, header->reverse_edges, mapping, inv_graph);
+
+    // Snapshots are written from loaded graphs with the same Cost width, their path costs were checked then
+    return (valid_snapshot_graph(graph, header->forward_edges) &&
+            valid_snapshot_graph(inv_graph, header->reverse_edges));
 }
\ No newline at end of file
@@ -7,7 +7,23 @@
 #include <vector>
 #include "Definitions.h"
 
+// All the loaders below also read gzip compressed files (.gr.gz, .co.gz) directly, decompressing
+// on a separate thread while parsing
 bool load_gr_files(std::string gr_file1, std::string gr_file2, std::vector<Edge> &edges, size_t &graph_size);
+// Reads both .gr files twice (degree count, then scatter) into the forward and reverse graphs, so no
+// intermediate edge list is materialised. Both passes run on chunks of the files in parallel: every chunk
+// counts its degrees, after which it has its own slots in every vertex's arcs. The file order is kept.
+// Compressed files are materialised once instead (see load_gr_files).
+// Fails on graphs whose path costs do not fit the Cost type of the build (see path_costs_fit).
+bool load_gr_graphs(std::string gr_file1, std::string gr_file2, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph);
 bool load_queries(std::string query_file, std::vector<std::pair<size_t, size_t>> &queries_out);
+// Loads a DIMACS .co file, coordinates_out[v] holds the (x, y) coordinates of vertex v as written
+// in the file (longitude and latitude in millionths of a degree for the DIMACS road maps)
+bool load_co_file(std::string co_file, std::vector<Pair<double>> &coordinates_out);
+
+// Binary graph snapshots hold the CSR columns of the forward and reverse graph, so they can be
+// memory mapped and used in place instead of parsing the .gr files on every run
+bool save_graph_snapshot(std::string snapshot_file, const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph);
+bool load_graph_snapshot(std::string snapshot_file, AdjacencyMatrix &graph, AdjacencyMatrix &inv_graph);
 
 #endif //UTILS_IO_UTILS_H
@@ -0,0 +1,100 @@
+#ifndef UTILS_INDEXED_HEAP_H
+#define UTILS_INDEXED_HEAP_H
+
+#include <vector>
+#include <algorithm>
+#include "Definitions.h"
+#include "HugePages.h"
+
+// 4-ary min heap of vertices for Dijkstra style searches, shallower than a binary heap and the children
+// of a slot share a cache line. Every vertex is queued at most once: positions[v] is its slot in the heap,
+// so a better key lowers the queued entry instead of adding a duplicate. Keys are stored next to the
+// vertex ids, sifting never touches the caller's arrays.
+class IndexedHeap {
+private:
+    struct Entry {
+        Cost        key;
+        VertexId    vertex;
+    };
+
+    std::vector<Entry>          entries;
+    HugePageVector<VertexId>    positions;  // MAX_VERTEX_ID for vertices not in the heap
+
+    void place(size_t slot, const Entry &entry) {
+        this->entries[slot] = entry;
+        this->positions[entry.vertex] = (VertexId)slot;
+    }
+
+    void sift_up(size_t slot, Entry entry) {
+        while (slot > 0) {
+            size_t parent = (slot - 1) / 4;
+            if (this->entries[parent].key <= entry.key) {
+                break;
+            }
+            this->place(slot, this->entries[parent]);
+            slot = parent;
+        }
+        this->place(slot, entry);
+    }
+
+    void sift_down(size_t slot, Entry entry) {
+        size_t size = this->entries.size();
+        for (size_t first = 4*slot + 1; first < size; first = 4*slot + 1) {
+            size_t child = first;
+            size_t last = std::min(first + 4, size);
+            for (size_t sibling = first + 1; sibling < last; ++sibling) {
+                if (this->entries[sibling].key < this->entries[child].key) {
+                    child = sibling;
+                }
+            }
+            if (entry.key <= this->entries[child].key) {
+                break;
+            }
+            this->place(slot, this->entries[child]);
+            slot = child;
+        }
+        this->place(slot, entry);
+    }
+
+public:
+    // Vertex ids are in [0, vertices)
+    IndexedHeap(size_t vertices) : positions(vertices, MAX_VERTEX_ID) {}
+
+    bool empty(void) const { return this->entries.empty(); }
+
+    // Queues the vertex with the given key, or lowers its key when it is already queued with a larger one
+    void push_or_decrease(size_t vertex, Cost key) {
+        VertexId slot = this->positions[vertex];
+        if (slot == MAX_VERTEX_ID) {
+            this->entries.push_back({key, (VertexId)vertex});
+            this->sift_up(this->entries.size() - 1, {key, (VertexId)vertex});
+        } else if (key < this->entries[slot].key) {
+            this->sift_up(slot, {key, (VertexId)vertex});
+        }
+    }
+
+    // Key of the vertex with the smallest key
+    Cost top_key(void) const { return this->entries.front().key; }
+
+    // Removes all queued vertices, in time proportional to their number
+    void clear(void) {
+        for (auto entry = this->entries.begin(); entry != this->entries.end(); ++entry) {
+            this->positions[entry->vertex] = MAX_VERTEX_ID;
+        }
+        this->entries.clear();
+    }
+
+    // Removes the vertex with the smallest key and returns it
+    size_t pop(void) {
+        Entry top = this->entries.front();
+        Entry last = this->entries.back();
+        this->entries.pop_back();
+        this->positions[top.vertex] = MAX_VERTEX_ID;
+        if (this->entries.empty() == false) {
+            this->sift_down(0, last);
+        }
+        return top.vertex;
+    }
+};
+
+#endif //UTILS_INDEXED_HEAP_H
@@ -0,0 +1,66 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedFile.h"
+
+
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+
+bool MappedFile::open(const std::string &filename) {
+    this->close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    this->length = (size_t)file_stat.st_size;
+    if (this->length == 0) {
+        // mmap rejects empty mappings, an empty file is simply an empty range
+        ::close(fd);
+        this->data = "";
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        this->length = 0;
+        return false;
+    }
+
+    this->data = static_cast<const char *>(mapping);
+    return true;
+}
+
+
+void MappedFile::close(void) {
+    if ((this->data != nullptr) && (this->length > 0)) {
+        munmap(const_cast<char *>(this->data), this->length);
+    }
+    this->data = nullptr;
+    this->length = 0;
+}
+
+
+bool MappedFile::is_open(void) const {return this->data != nullptr;}
+
+
+const char *MappedFile::begin(void) const {return this->data;}
+
+
+const char *MappedFile::end(void) const {return this->data + this->length;}
+
+
+size_t MappedFile::size(void) const {return this->length;}
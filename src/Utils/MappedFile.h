@@ -0,0 +1,28 @@
+#ifndef UTILS_MAPPED_FILE_H
+#define UTILS_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+// Read only memory mapping of a whole file. The mapping is released on destruction,
+// so objects pointing into it should keep the MappedFile alive (e.g. via shared_ptr).
+class MappedFile {
+private:
+    const char  *data = nullptr;
+    size_t      length = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    bool open(const std::string &filename);
+    void close(void);
+    bool is_open(void) const;
+    const char *begin(void) const;
+    const char *end(void) const;
+    size_t size(void) const;
+};
+
+#endif //UTILS_MAPPED_FILE_H
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "Numa.h"
+#include "GraphReordering.h"
+
+const std::string NUMA_SYSFS_ROOT = "/sys/devices/system/node/";
+
+
+// Parses a sysfs CPU list such as "0-3,8-11"
+std::vector<size_t> parse_cpu_list(const std::string &cpu_list) {
+    std::vector<size_t> cpus;
+    size_t pos = 0;
+    while (pos < cpu_list.size()) {
+        size_t range_end = cpu_list.find(',', pos);
+        if (range_end == std::string::npos) {
+            range_end = cpu_list.size();
+        }
+        std::string range = cpu_list.substr(pos, range_end - pos);
+        size_t dash = range.find('-');
+        try {
+            size_t first = std::stoul(range.substr(0, dash));
+            size_t last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+            for (size_t cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error &) {
+            // Empty or malformed ranges (e.g. the trailing newline) are skipped
+        }
+        pos = range_end + 1;
+    }
+    return cpus;
+}
+
+
+std::vector<NumaNode> discover_numa_nodes(void) {
+    std::vector<NumaNode> nodes;
+    DIR *directory = opendir(NUMA_SYSFS_ROOT.c_str());
+    if (directory != nullptr) {
+        struct dirent *entry;
+        while ((entry = readdir(directory)) != nullptr) {
+            std::string name = entry->d_name;
+            if ((name.compare(0, 4, "node") != 0) || (name.size() == 4) ||
+                (name.find_first_not_of("0123456789", 4) != std::string::npos)) {
+                continue;
+            }
+
+            std::ifstream cpu_list_file((NUMA_SYSFS_ROOT + name + "/cpulist").c_str());
+            std::string cpu_list;
+            std::getline(cpu_list_file, cpu_list);
+            NumaNode node = {std::stoul(name.substr(4)), parse_cpu_list(cpu_list)};
+            if (node.cpus.empty() == false) {
+                nodes.push_back(node); // Memory only nodes can not run workers
+            }
+        }
+        closedir(directory);
+    }
+
+    if (nodes.empty()) {
+        NumaNode node = {0, {}};
+        size_t cpus_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+        for (size_t cpu = 0; cpu < cpus_count; ++cpu) {
+            node.cpus.push_back(cpu);
+        }
+        nodes.push_back(node);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode &a, const NumaNode &b) {return a.id < b.id;});
+    return nodes;
+}
+
+
+bool bind_thread_to_node(const NumaNode &node) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu = node.cpus.begin(); cpu != node.cpus.end(); ++cpu) {
+        if (*cpu < CPU_SETSIZE) {
+            CPU_SET(*cpu, &cpu_set);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        return false;
+    }
+
+    const size_t BITS_PER_WORD = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> node_mask(node.id / BITS_PER_WORD + 1, 0);
+    node_mask[node.id / BITS_PER_WORD] |= 1UL << (node.id % BITS_PER_WORD);
+    // Preferred rather than bound: a full node spills over to the others instead of reclaiming or failing
+    syscall(SYS_set_mempolicy, MPOL_PREFERRED, node_mask.data(), node_mask.size() * BITS_PER_WORD + 1);
+    return true;
+}
+
+
+// Starts thread_counts[i] threads bound to nodes[i] running `work(i)` and waits for all of them
+void run_node_threads(const std::vector<NumaNode> &nodes, const std::vector<size_t> &thread_counts,
+                      const std::function<void(size_t)> &work) {
+    std::vector<std::thread> threads;
+    for (size_t node_index = 0; node_index < nodes.size(); ++node_index) {
+        for (size_t i = 0; i < thread_counts[node_index]; ++i) {
+            threads.push_back(std::thread([&nodes, &work, node_index]() {
+                // Single node machines gain nothing from pinning, leave the threads to the scheduler
+                if (nodes.size() > 1) {
+                    bind_thread_to_node(nodes[node_index]);
+                }
+                work(node_index);
+            }));
+        }
+    }
+    for (auto thread = threads.begin(); thread != threads.end(); ++thread) {
+        thread->join();
+    }
+}
+
+
+void run_on_numa_nodes(const std::vector<NumaNode> &nodes, size_t threads_per_node,
+                       const std::function<void(size_t)> &work) {
+    run_node_threads(nodes, std::vector<size_t>(nodes.size(), threads_per_node), work);
+}
+
+
+void run_on_numa_cpus(const std::vector<NumaNode> &nodes, const std::function<void(size_t)> &work) {
+    std::vector<size_t> thread_counts;
+    for (auto node = nodes.begin(); node != nodes.end(); ++node) {
+        thread_counts.push_back(std::max<size_t>(1, node->cpus.size()));
+    }
+    run_node_threads(nodes, thread_counts, work);
+}
+
+
+NumaGraphReplicas::NumaGraphReplicas(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph)
+    : nodes(discover_numa_nodes()), graphs(nodes.size()), inv_graphs(nodes.size()) {
+    if (this->nodes.size() == 1) {
+        this->graphs[0] = graph;
+        this->inv_graphs[0] = inv_graph;
+        return;
+    }
+
+    // Every replica is built by a thread bound to its node, so its pages are allocated there while the node has room.
+    // Replicas keep the layout of the source (compressed or sharing the symmetric arcs).
+    bool shared = graph.shares_storage_with(inv_graph);
+    run_on_numa_nodes(this->nodes, 1, [&](size_t node_index) {
+        VertexOrdering identity;
+        AdjacencyMatrix replica = identity.permute(graph);
+        AdjacencyMatrix inv_replica = identity.permute(inv_graph);
+        if (shared) {
+            share_symmetric_arcs(replica, inv_replica);
+        }
+        this->graphs[node_index] = graph.is_compressed() ? replica.compress() : replica;
+        this->inv_graphs[node_index] = inv_graph.is_compressed() ? inv_replica.compress() : inv_replica;
+    });
+}
+
+
+const std::vector<NumaNode> &NumaGraphReplicas::numa_nodes() const {return this->nodes;}
+
+
+const AdjacencyMatrix &NumaGraphReplicas::graph(size_t node_index) const {return this->graphs.at(node_index);}
+
+
+const AdjacencyMatrix &NumaGraphReplicas::inv_graph(size_t node_index) const {return this->inv_graphs.at(node_index);}
@@ -0,0 +1,46 @@
+#ifndef UTILS_NUMA_H
+#define UTILS_NUMA_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Definitions.h"
+
+// NUMA support without libnuma: the topology is read from sysfs and memory placement relies on
+// the set_mempolicy system call plus first touch by threads pinned to the node's CPUs.
+struct NumaNode {
+    size_t              id;
+    std::vector<size_t> cpus;
+};
+
+// The NUMA nodes with CPUs. Machines without NUMA information report a single node with all CPUs.
+std::vector<NumaNode> discover_numa_nodes(void);
+// Pins the calling thread to the CPUs of the node and makes the node's memory the preferred place of its future
+// allocations. Returns false if the thread could not be pinned, a failed memory policy alone is tolerated
+// as pinned threads still allocate locally on first touch.
+bool bind_thread_to_node(const NumaNode &node);
+// Runs `work(node_index)` on `threads_per_node` threads bound to every node and waits for all of them
+void run_on_numa_nodes(const std::vector<NumaNode> &nodes, size_t threads_per_node,
+                       const std::function<void(size_t)> &work);
+// Runs `work(node_index)` on one thread per CPU of every node (nodes differ in their CPU counts)
+void run_on_numa_cpus(const std::vector<NumaNode> &nodes, const std::function<void(size_t)> &work);
+
+
+// Copies of a graph and its reverse in the local memory of every NUMA node, so threads bound to
+// a node never read the graph across the interconnect. On one node machines the graphs are
+// used in place and nothing is copied.
+class NumaGraphReplicas {
+private:
+    std::vector<NumaNode>           nodes;
+    std::vector<AdjacencyMatrix>    graphs;
+    std::vector<AdjacencyMatrix>    inv_graphs;
+
+public:
+    NumaGraphReplicas(const AdjacencyMatrix &graph, const AdjacencyMatrix &inv_graph);
+
+    const std::vector<NumaNode> &numa_nodes(void) const;
+    const AdjacencyMatrix &graph(size_t node_index) const;
+    const AdjacencyMatrix &inv_graph(size_t node_index) const;
+};
+
+#endif //UTILS_NUMA_H
@@ -0,0 +1,67 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "../src/Utils/Definitions.h"
+#include "../src/Utils/IOUtils.h"
+#include "../src/Utils/ContractionHierarchy.h"
+#include "../src/Example/HeuristicStore.h"
+#include "../src/Example/QueryGraphs.h"
+
+// Precomputes the shortest path heuristic tables of the targets of a queries file (the second vertex of
+// every line) into a heuristic store. The graphs are prepared like run_queries prepares them (see
+// prepare_query_graphs), renumbered and not simplified by default, the flags follow other settings of run_example.
+int main(int argc, char **argv) {
+    bool reorder = true;
+    bool simplify = false;
+    bool valid_flags = true;
+    for (int arg = 5; arg < argc; ++arg) {
+        std::string flag = argv[arg];
+        if (flag == "--no-reorder") {
+            reorder = false;
+        } else if (flag == "--simplify") {
+            simplify = true;
+        } else {
+            valid_flags = false;
+        }
+    }
+    if ((argc < 5) || (valid_flags == false)) {
+        std::cout << "Usage: " << argv[0] << " <distance.gr> <time.gr> <queries> <output.heuristics>"
+                  << " [--no-reorder] [--simplify]" << std::endl;
+        return 1;
+    }
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (load_gr_graphs(argv[1], argv[2], graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    if (load_queries(argv[3], queries) == false) {
+        std::cout << "Failed to load queries file" << std::endl;
+        return 1;
+    }
+    VertexOrdering ordering;
+    GraphSimplification simplification;
+    prepare_query_graphs(graph, inv_graph, queries, reorder, simplify, ordering, simplification);
+    std::vector<size_t> targets;
+    for (auto iter = queries.begin(); iter != queries.end(); ++iter) {
+        targets.push_back(iter->second);
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    ContractionHierarchy hierarchy0(inv_graph, 0);
+    ContractionHierarchy hierarchy1(inv_graph, 1);
+    if (save_heuristic_store(argv[4], graph, targets, {{&hierarchy0, &hierarchy1}}) == false) {
+        std::cout << "Failed to write heuristic store " << argv[4] << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    HeuristicStore store;
+    store.open(argv[4], graph);
+    std::cout << "Wrote " << argv[4] << ": " << store.count() << " targets in " << elapsed.count() << "s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <iostream>
+#include <string>
+
+#include "../src/Utils/Definitions.h"
+#include "../src/Utils/IOUtils.h"
+
+// Converts a pair of DIMACS .gr files (distance and time costs of the same arcs) into a binary
+// graph snapshot that load_graph_snapshot can map and use without parsing
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::cout << "Usage: " << argv[0] << " <distance.gr> <time.gr> <output.snapshot>" << std::endl;
+        return 1;
+    }
+
+    AdjacencyMatrix graph;
+    AdjacencyMatrix inv_graph;
+    if (load_gr_graphs(argv[1], argv[2], graph, inv_graph) == false) {
+        std::cout << "Failed to load gr files" << std::endl;
+        return 1;
+    }
+
+    if (save_graph_snapshot(argv[3], graph, inv_graph) == false) {
+        std::cout << "Failed to write snapshot " << argv[3] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << argv[3] << ": " << graph.size() << " vertices, " << graph.edges_count() << " arcs" << std::endl;
+    return 0;
+}